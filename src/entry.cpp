@@ -8,6 +8,7 @@
 #include "pch.hpp"
 #include "stiac-support.hpp"
 #include "node/daemon.hpp"
+#include "node/handoff.hpp"
 
 namespace dci::module::ppn::node
 {
@@ -33,6 +34,13 @@ namespace dci::module::ppn::node
                 return manifest_;
             }
 
+            bool stop() override
+            {
+                //not left to static destruction, the runtime is gone by then
+                Handoff::instance().release();
+                return dci::host::module::Entry::stop();
+            }
+
             cmt::Future<idl::Interface> createService(idl::ILid ilid) override
             {
                 if(auto s = tryCreateService<Daemon>(ilid)) return cmt::readyFuture(s);
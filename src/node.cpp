@@ -51,6 +51,49 @@ namespace dci::module::ppn
         config::ptree conf = config::cnvt(std::move(config));
         config::ptree nullConf{};
 
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //persistent state
+        String statePath = conf.get("state", "");
+        if(!statePath.empty())
+        {
+            _state.open(statePath);
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //key, taken from an owner-only file next to the state while its fingerprint holds, otherwise derived,
+        //the material fetchers run concurrently and are accumulated in their fixed order
+        config::ptree keyConf = conf.get_child("key", nullConf);
+        api::link::Key key;
+        {
+            std::optional<String> keyFingerprint = node::utils::keyFingerprint(keyConf);
+            std::filesystem::path keyPath = statePath.empty() ? std::filesystem::path{} : std::filesystem::path{statePath + ".key"};
+
+            bool cached = false;
+            if(keyFingerprint && !keyPath.empty())
+            {
+                std::ifstream in{keyPath};
+                String fingerprint, value;
+                if(in >> fingerprint >> value && fingerprint == *keyFingerprint)
+                {
+                    cached = node::utils::fromHex(value, key.data(), key.size());
+                }
+            }
+
+            if(!cached)
+            {
+                key = node::utils::parseKey(keyConf);
+
+                if(keyFingerprint && !keyPath.empty())
+                {
+                    std::error_code ec;
+                    if(!node::utils::writeOwnerOnly(keyPath, *keyFingerprint + " " + node::utils::toHex(key.data(), key.size()) + "\n", ec))
+                    {
+                        LOGW("unable to cache node key "<<keyPath.string()<<": "<<ec.message());
+                    }
+                }
+            }
+        }
+
         /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
         {
             _featureService.init();
@@ -61,10 +104,13 @@ namespace dci::module::ppn
 
             _featureService->join() += sol() * [this](const api::link::Id& id, const transport::Address& a)
             {
+                remoteTouch(id);
+
                 cmt::Promise<api::link::Remote<>> promise;
                 cmt::Future<api::link::Remote<>> future = promise.future();
                 _joinWaiters.emplace(a, std::move(promise));
 
+                //out of the feature call, the session signals reenter features
                 cmt::spawn() += _tow * [=, this]
                 {
                     csessionWorker(id, a);
@@ -76,6 +122,8 @@ namespace dci::module::ppn
             //Connectors
             _featureService->connect() += sol() * [this](const api::link::Id& id, const transport::Address& a)
             {
+                remoteTouch(id);
+
                 cmt::spawn() += _tow * [=, this]
                 {
                     csessionWorker(id, a);
@@ -94,6 +142,21 @@ namespace dci::module::ppn
                 return cmt::readyFuture(_declaredLocalAddresses);
             };
 
+            _featureService->getDeclaredVersion() += sol() * [this]()
+            {
+                return cmt::readyFuture(_declaredJournal.version());
+            };
+
+            _featureService->getDeclaredSince() += sol() * [this](uint64 version)
+            {
+                return cmt::readyFuture(_declaredJournal.since(version, _declaredLocalAddresses));
+            };
+
+            _featureService->getDeclaredReachability() += sol() * [this]()
+            {
+                return cmt::readyFuture(_reachability);
+            };
+
             _featureService->declare() += sol() * [this](const transport::Address& a){localAddressDeclare(a);};
             _featureService->undeclare() += sol() * [this](const transport::Address& a){localAddressUndeclare(a);};
 
@@ -129,6 +192,28 @@ namespace dci::module::ppn
             };
         }
 
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //introspection
+        (*this)->sessionStats() += sol() * [this]()
+        {
+            return cmt::readyFuture(sessionStats());
+        };
+
+        (*this)->stats() += sol() * [this]()
+        {
+            return cmt::readyFuture(stats());
+        };
+
+        (*this)->remotes() += sol() * [this](uint32 limit)
+        {
+            return cmt::readyFuture(remotes(limit));
+        };
+
+        (*this)->drain() += sol() * [this]()
+        {
+            return drain();
+        };
+
         /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
         //features
         List<api::link::Feature<>> linkFeatures;
@@ -185,10 +270,10 @@ namespace dci::module::ppn
         /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
         //link
         {
-            api::link::Key key = node::utils::parseKey(conf.get_child("key", nullConf));
             _link = dciModuleEntry->manager()->createService<api::link::Local<>>().value();
             _link->setKey(key);
             _link->setFeatures(std::move(linkFeatures));
+            _ownId = _link->id().value();
         }
 
         /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
@@ -199,9 +284,61 @@ namespace dci::module::ppn
             rdbFeatures.clear();
         }
 
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //faults for sim:// addresses
+        _sim.configure(conf.get_child("sim", nullConf));
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //remotes cap
+        {
+            _remotesMax = node::utils::parseUint32(conf.get("remotes.max", "0"));
+            _remotesInboundReserve = node::utils::parseUint32(conf.get("remotes.inbound", "0"));
+            _remotesOutboundReserve = node::utils::parseUint32(conf.get("remotes.outbound", "0"));
+
+            if(_remotesMax && _remotesInboundReserve + _remotesOutboundReserve > _remotesMax)
+            {
+                throw api::Error("remotes reservations exceed remotes.max");
+            }
+
+            String evict = conf.get("remotes.evict", "lru");
+            if("none" == evict) _remotesEvict = RemotesEvict::none;
+            else if("lru" == evict) _remotesEvict = RemotesEvict::lru;
+            else if("oldest" == evict) _remotesEvict = RemotesEvict::oldest;
+            else if("slowest" == evict) _remotesEvict = RemotesEvict::slowest;
+            else throw api::Error("bad remotes.evict value: "+evict);
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //idle reaper
+        {
+            _idleWheel.configure(std::chrono::seconds{node::utils::parseUint32(conf.get("remotes.idle", "0"))});
+            if(_idleWheel.timeout().count())
+            {
+                _idleTimer.reset(new poll::Timer{_idleWheel.tick(), true, [this]{idleTick();}});
+            }
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //acceptors handoff to the next node in this process
+        {
+            _handoff = node::utils::parseBool(conf.get("handoff", "false"));
+            _handoffTtl = std::chrono::seconds{node::utils::parseUint32(conf.get("handoff.ttl", "30"))};
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //graceful leave
+        {
+            _drainOnStop = node::utils::parseBool(conf.get("drain", "false"));
+            _drainDeadline = std::chrono::seconds{node::utils::parseUint32(conf.get("drain.deadline", "30"))};
+            _drainBatch = std::max(uint32{1}, node::utils::parseUint32(conf.get("drain.batch", "64")));
+            _drainPace = std::chrono::milliseconds{std::max(uint32{1}, node::utils::parseUint32(conf.get("drain.pace", "200")))};
+        }
+
         /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
         //transport connctors
         {
+            _connectMatchScope = node::utils::parseBool(conf.get("connect.matchScope", "false"));
+
             _connectors.loAdded() += sol() * [this](const transport::Address& a)
             {
                 _featureService->connectorStarted(a);
@@ -214,9 +351,11 @@ namespace dci::module::ppn
             _connectors.start(
                         dciModuleEntry->manager()->createService<transport::Connector<>>().value(),
                         [this](const transport::Address& a){return fixConnectorAddress(a);},
-                        [this](const transport::Address& a){return makeConnector(a);},
+                        [this](const transport::Address& a, const config::ptree& options){return makeConnector(a, options);},
                         conf.get_child("connect", nullConf),
-                        [this]()->node::NetEnumerator&{return netEnumerator();});
+                        [this]()->node::NetEnumerator&{return netEnumerator();},
+                        _state,
+                        "connect");
         }
 
         /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
@@ -234,72 +373,74 @@ namespace dci::module::ppn
             _acceptors.start(
                         dciModuleEntry->manager()->createService<transport::Acceptor<>>().value(),
                         [this](const transport::Address& a){return fixAcceptorAddress(a);},
-                        [this](const transport::Address& a){return makeAcceptor(a);},
+                        [this](const transport::Address& a, const config::ptree& options){return makeAcceptor(a, options);},
                         conf.get_child("accept", nullConf),
-                        [this]()->node::NetEnumerator&{return netEnumerator();});
+                        [this]()->node::NetEnumerator&{return netEnumerator();},
+                        _state,
+                        "accept");
 
             transport::Acceptor<> ah = _acceptors.hi();
 
             //out started(transport::Address);
-            ah->started() += sol() * [=,this](const transport::Address& a1, const transport::Address& a2)
+            ah->started() += sol() * [=,this](const transport::Address& a1, const transport::Address& carrier)
             {
+                transport::Address a2 = node::Sim::fromCarrier(carrier);
                 _featureService->acceptorStarted(a1, a2);
                 localAddressDeclare(a2);
 
-                auto nmIter = _nattMappings.find(a2);
-                if(_nattMappings.end() == nmIter && _natt)
-                {
-                    _natt->mapping().then() += sol() * [=,this](cmt::Future<transport::natt::Mapping<>> in)
-                    {
-                        if(!_started) return;
-
-                        if(in.resolvedValue())
-                        {
-                            _nattMappings.emplace(std::piecewise_construct_t{},
-                                                  std::tie(a2),
-                                                  std::forward_as_tuple(this, in.detachValue(), a2));
-                        }
-                        else if(in.resolvedException())
-                        {
-                            LOGW("mapping failed: "<<exception::toString(in.detachException()));
-                        }
-                        else //if(in.resolvedCancel())
-                        {
-                            LOGW("mapping canceled");
-                        }
-                    };
-                }
+                nattAttach(a2);
             };
 
             //out stopped(transport::Address);
-            ah->stopped() += sol() * [=,this](const transport::Address& a1, const transport::Address& a2)
+            ah->stopped() += sol() * [=,this](const transport::Address& a1, const transport::Address& carrier)
             {
+                transport::Address a2 = node::Sim::fromCarrier(carrier);
                 _featureService->acceptorStopped(a1, a2);
                 localAddressUndeclare(a2);
 
-                _nattMappings.erase(a2);
+                nattDetach(a2);
             };
 
             //out failed(transport::Address, exception);
             ah->failed() += sol() * [this](const transport::Address& a1, const transport::Address& a2, const ExceptionPtr& e)
             {
-                _featureService->acceptorFailed(a1, a2, e);
+                _featureService->acceptorFailed(a1, node::Sim::fromCarrier(a2), e);
             };
 
+            _acceptWorkers = node::utils::parseUint32(conf.get("accept.workers", "0"));
+            _acceptPendingMax = node::utils::parseUint32(conf.get("accept.pending", "1024"));
+            _sourceLimiter.configure(conf.get_child("accept", nullConf));
+
             ah->accepted() += sol() * [this](transport::Channel<>&& ch)
             {
-                cmt::spawn() += _tow * [ch=std::move(ch),this]() mutable
-                {
-                    asessionWorker(std::move(ch));
-                };
+                asessionAdmit(std::move(ch));
             };
         }
 
         /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
         //transport natt
         {
+            config::ptree nattConf = conf.get_child("natt", nullConf);
+
+            _nattPersist = node::utils::parseBool(nattConf.get("persist", "true"));
+            nattConf.erase("persist");
+
             _natt = dciModuleEntry->manager()->createService<transport::Natt<>>().value();
-            _natt->configure(config::cnvt(conf.get_child("natt", nullConf)));
+            _natt->configure(config::cnvt(std::move(nattConf)));
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //self-probe
+        {
+            _probe = node::utils::parseBool(conf.get("probe", "false"));
+            if(_probe)
+            {
+                std::chrono::seconds interval{node::utils::parseUint32(conf.get("probe.interval", "600"))};
+                _probeTimer.reset(new poll::Timer{interval, true, [this]{probeAll();}});
+
+                std::chrono::milliseconds hold{node::utils::parseUint32(conf.get("probe.hold", "2000"))};
+                _probeHeldTimer.reset(new poll::Timer{hold, false, [this]{probeRelease();}});
+            }
         }
 
         /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
@@ -315,22 +456,237 @@ namespace dci::module::ppn
         //start features
         _featureService->start();
 
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //mappings known from previous run, requested while acceptors are starting
+        nattRestore();
+
         /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
         //listen
         _acceptors.hi()->start();
+        handoffAdmit();
+
+        if(_probeTimer)
+        {
+            _probeTimer->start();
+            probeAll();
+        }
+
+        if(_idleTimer)
+        {
+            _idleTimer->start();
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //metrics exporter
+        if(node::utils::parseBool(conf.get("exporter", "false")))
+        {
+            std::chrono::seconds interval{node::utils::parseUint32(conf.get("exporter.interval", "5"))};
+
+            _exporter.reset(new node::Exporter);
+            _exporter->start(conf.get("exporter.listen", "tcp4://127.0.0.1:9464"));
+            _exporterTimer.reset(new poll::Timer{interval, true, [this]{exportMetrics();}});
+            _exporterTimer->start();
+            exportMetrics();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Node::drainOnStop() const
+    {
+        return _drainOnStop;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::chrono::seconds Node::drainDeadline() const
+    {
+        return _drainDeadline;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<bool> Node::drain()
+    {
+        cmt::Promise<bool> promise;
+        cmt::Future<bool> res = promise.future();
+
+        if(!_started || _drained)
+        {
+            //stopped or drained already
+            promise.resolveValue(_remotes.empty());
+            return res;
+        }
+
+        _drainWaiters.emplace_back(std::move(promise));
+        if(_draining)
+        {
+            return res;
+        }
+
+        LOGI("draining, deadline "<<_drainDeadline.count()<<"s");
+
+        _draining = true;
+        _drainBegin = std::chrono::steady_clock::now();
+
+        //stop accepting and stop being advertised, parked acceptors keep queuing for the successor
+        if(_handoff)
+        {
+            handoffAcceptors();
+        }
+        else if(auto a = _acceptors.hi(); a)
+        {
+            a->stop();
+        }
+        _acceptPending.clear();
+        _probeHeld.clear();
+
+        for(const transport::Address& a : Set<transport::Address>{_declaredLocalAddresses})
+        {
+            localAddressUndeclare(a);
+        }
+
+        _drainTimer.reset(new poll::Timer{_drainPace, true, [this]{drainTick();}});
+        _drainTimer->start();
+        _drainDeadlineTimer.reset(new poll::Timer{_drainDeadline, false, [this]{drainDone();}});
+        _drainDeadlineTimer->start();
+        drainTick();
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::handoffAcceptors()
+    {
+        //once, by drain or by stop whichever comes first
+        if(_handedOff)
+        {
+            return;
+        }
+        _handedOff = true;
+
+        _acceptors.stop([this](const transport::Address& a, transport::acceptor::Downstream<>&& lo)
+        {
+            LOGI("acceptor parked for handoff: "<<a.value);
+            node::Handoff::instance().park(a, std::move(lo), _handoffTtl);
+        });
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::handoffAdmit()
+    {
+        //accepted by the predecessor's parked acceptors, sessions start only while running
+        if(!_started)
+        {
+            return;
+        }
+
+        for(transport::Channel<>& ch : std::exchange(_handoffAccepted, {}))
+        {
+            asessionAdmit(std::move(ch));
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::drainTick()
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        bool handshakes = _sessionsConnecting || _sessionsAccepting;
+        if(now - _drainBegin >= _drainDeadline || (!handshakes && _remotes.empty()))
+        {
+            drainDone();
+            return;
+        }
+
+        //in-flight handshakes are given the first half of the deadline to finish
+        if(handshakes && now - _drainBegin < _drainDeadline / 2)
+        {
+            return;
+        }
+
+        //paced batches, not all the peers rush to reconnect elsewhere at once; closed ones are
+        //left in the table until their close completes, so they are skipped, not closed again
+        std::vector<api::link::Remote<>> batch;
+        for(auto&[id, e] : _remotes)
+        {
+            if(batch.size() >= _drainBatch) break;
+            if(!e._closing)
+            {
+                e._closing = true;
+                batch.push_back(e._remote);
+            }
+        }
+
+        for(api::link::Remote<>& r : batch)
+        {
+            r->close();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::drainDone()
+    {
+        if(_drained)
+        {
+            return;
+        }
+        _drained = true;
+
+        if(_remotes.empty())
+        {
+            LOGI("drained");
+        }
+        else
+        {
+            LOGW("drain deadline reached, remotes left: "<<_remotes.size());
+        }
+
+        //may be inside a callback of either, so stopped here and freed by stop
+        _drainTimer->stop();
+        _drainDeadlineTimer->stop();
+
+        for(cmt::Promise<bool>& p : std::exchange(_drainWaiters, {}))
+        {
+            p.resolveValue(_remotes.empty());
+        }
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     void Node::stop()
     {
         _started = false;
+
+        //unfinished sessions are failed while everything they touch is alive, then their continuations are dropped
+        _acceptPending.clear();
+        _probeHeld.clear();
+        _handoffAccepted.clear();
+        sessionsCancel();
         sol().flush();
 
+        if(_draining)
+        {
+            drainDone();
+        }
+        _draining = false;
+        _drained = false;
+        _drainTimer.reset();
+        _drainDeadlineTimer.reset();
+
+        _probeTimer.reset();
+        _probeHeldTimer.reset();
+        _reachability.clear();
+        _probing.clear();
+        _probeSources.clear();
+
+        _exporterTimer.reset();
+        _exporter.reset();
+
+        _nattTimer.stop();
         for(const auto&[i, m] : _nattMappings)
         {
-            m._api->stop();
+            if(m._api) m._api->stop();
         }
         _nattMappings.clear();
+        _nattPending.clear();
+        _nattMembers.clear();
 
         _connectionsInProgress.clear();
         _joinWaiters.clear();
@@ -342,6 +698,12 @@ namespace dci::module::ppn
 
         _tow.flush();
 
+        if(_handoff)
+        {
+            //detached before hi is stopped, it would stop them too
+            handoffAcceptors();
+        }
+
         if(auto a = _acceptors.hi(); a)
         {
             a->stop();
@@ -352,6 +714,16 @@ namespace dci::module::ppn
 
         _tow.flush();
 
+        //joined sessions are released by the flush of sol without their closed
+        _sessionsJoined = 0;
+        _remotes.clear();
+        _remotesInbound = 0;
+        _remotesOutbound = 0;
+        _remotesEvicting.clear();
+
+        _idleTimer.reset();
+        _idleWheel.clear();
+
         _featureService.reset();
         _rdbInstance.reset();
         _link.reset();
@@ -362,77 +734,283 @@ namespace dci::module::ppn
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     void Node::localAddressDeclare(const transport::Address& a)
     {
+        if(_draining)
+        {
+            //leaving, nothing new is advertised
+            return;
+        }
+
         if(_declaredLocalAddresses.emplace(a).second)
         {
+            _declaredJournal.changed(a);
+
+            api::feature::AddressReachability& r = _reachability[a];
+            r.probed = false;
+            r.reachable = false;
+            r.scope = node::utils::addressScope(a);
+            r.weight = 0;
+            r.latencyMs = 0;
+
             if(_started) _featureService->declared(a);
+            if(_started && _probe) probe(a);
         }
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     void Node::localAddressUndeclare(const transport::Address& a)
     {
-
         auto iter = _declaredLocalAddresses.find(a);
         if(_declaredLocalAddresses.end() != iter)
         {
             _declaredLocalAddresses.erase(iter);
+            _reachability.erase(a);
+            _declaredJournal.changed(a);
             if(_started) _featureService->undeclared(a);
         }
     }
 
-    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    void Node::emitFail(const std::string& comment)
-    {
-        auto e = exception::buildInstance<api::Error>(comment);
-        if(_started) _featureService->failed(e);
-    }
-
-    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    void Node::emitFail(ExceptionPtr e, const std::string& comment)
+    namespace
     {
-        e = exception::buildInstance<api::Error>(std::move(e), comment);
-        if(_started) _featureService->failed(e);
+        uint32 reachabilityWeight(uint32 scope)
+        {
+            if(scope & static_cast<uint32>(dci::utils::ip::Scope::wan)) return 100;
+            if(scope & static_cast<uint32>(dci::utils::ip::Scope::lan)) return 60;
+            if(scope & static_cast<uint32>(dci::utils::ip::Scope::link)) return 20;
+            return 10;
+        }
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    node::NetEnumerator& Node::netEnumerator()
+    void Node::probe(const transport::Address& a)
     {
-        if(!_netEnumerator)
+        if(!_probing.insert(a).second)
         {
-            _netEnumerator.reset(new node::NetEnumerator());
-            _netEnumerator->failed() += sol() * [this](ExceptionPtr&& e)
-            {
-                emitFail(std::move(e), "net enumerator failed");
-            };
+            //previous one is still in flight
+            return;
         }
 
-        return *_netEnumerator;
-    }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-    namespace
-    {
-        std::string fixAuto(const std::string& src, const std::string& repl)
+        //channel is dropped right after connect, its local end is remembered for own acceptors to drop the other end
+        _connectors.hi()->connect(fixConnectorAddress(node::Sim::toCarrier(a))).then() += sol() * [=,this](cmt::Future<transport::Channel<>> in)
         {
-            size_t pos = src.find("%auto%");
-            if(src.npos == pos)
+            if(!in.resolvedValue())
             {
-                return src;
+                probeDone(a, start, false);
+                return;
             }
 
-            std::string res = src;
-            res.replace(pos, 6, repl);
+            transport::Channel<> ch = in.detachValue();
+            cmt::Future<transport::Address> local = ch->localAddress();
+            local.then() += sol() * [ch=std::move(ch), a, start, this](cmt::Future<transport::Address> in) mutable
+            {
+                if(in.resolvedValue())
+                {
+                    _probeSources.insert(in.detachValue());
+                }
 
-            return res;
-        }
+                ch.reset();
+                probeDone(a, start, true);
+            };
+        };
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    transport::Address Node::fixAcceptorAddress(const transport::Address& a)
+    void Node::probeDone(const transport::Address& a, std::chrono::steady_clock::time_point start, bool reachable)
     {
-        dci::utils::URI<> uri;
-        if(dci::utils::uri::parse(a.value, uri))
+        _probing.erase(a);
+
+        auto iter = _reachability.find(a);
+        if(_reachability.end() != iter)
         {
-            if(std::holds_alternative<dci::utils::uri::Inproc<>>(uri))
+            api::feature::AddressReachability& r = iter->second;
+            r.probed = true;
+            r.reachable = reachable;
+            r.latencyMs = static_cast<uint32>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+            r.weight = r.reachable ? reachabilityWeight(r.scope) : 0;
+
+            if(!r.reachable)
+            {
+                LOGI("declared address is not reachable by self-probe: "<<a.value);
+            }
+        }
+
+        probeSettled();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Node::probeCandidate(const transport::Address& remote) const
+    {
+        if(_probing.empty())
+        {
+            return false;
+        }
+
+        //a probe comes from one of own hosts, or over a non-ip transport a probe of the same scheme is in flight
+        String host = node::utils::addressHost(remote);
+        if(!host.empty())
+        {
+            for(const transport::Address& a : _declaredLocalAddresses)
+            {
+                if(node::utils::addressHost(a) == host)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        String scheme = node::utils::addressScheme(remote);
+        for(const transport::Address& a : _probing)
+        {
+            if(node::utils::addressScheme(node::Sim::toCarrier(a)) == scheme)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::probeSettled()
+    {
+        if(!_probing.empty())
+        {
+            return;
+        }
+
+        //all probe sources are known now, held inbound channels are sorted out finally
+        probeRelease();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::probeRelease()
+    {
+        //by settled probes or by the hold deadline, what is not a known probe source goes the usual way
+        if(_probeHeldTimer)
+        {
+            _probeHeldTimer->stop();
+        }
+
+        List<std::pair<transport::Channel<>, transport::Address>> held;
+        held.swap(_probeHeld);
+        for(auto&[ch, remote] : held)
+        {
+            if(_probeSources.erase(remote))
+            {
+                continue;
+            }
+
+            asessionPass(std::move(ch), remote);
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::probeAll()
+    {
+        if(_probing.empty())
+        {
+            //sources of a previous round not seen by own acceptors, a hairpinning gateway rewrites them
+            _probeSources.clear();
+        }
+
+        for(const transport::Address& a : _declaredLocalAddresses)
+        {
+            probe(a);
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::emitFail(const std::string& comment)
+    {
+        auto e = exception::buildInstance<api::Error>(comment);
+        if(_started) _featureService->failed(e);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::emitFail(ExceptionPtr e, const std::string& comment)
+    {
+        e = exception::buildInstance<api::Error>(std::move(e), comment);
+        if(_started) _featureService->failed(e);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    node::NetEnumerator& Node::netEnumerator()
+    {
+        if(!_netEnumerator)
+        {
+            _netEnumerator.reset(new node::NetEnumerator());
+            _netEnumerator->failed() += sol() * [this](ExceptionPtr&& e)
+            {
+                emitFail(std::move(e), "net enumerator failed");
+            };
+        }
+
+        return *_netEnumerator;
+    }
+
+    namespace
+    {
+        constexpr uint64 joinBounds[] = {1000, 10000, 100000, 1000000, 10000000};
+
+        std::string fixAuto(const std::string& src, const std::string& repl)
+        {
+            size_t pos = src.find("%auto%");
+            if(src.npos == pos)
+            {
+                return src;
+            }
+
+            std::string res = src;
+            res.replace(pos, 6, repl);
+
+            return res;
+        }
+
+        void applySocketOptions(const idl::Interface& target, const transport::Address& a, const config::ptree& options, bool tcp)
+        {
+            if(options.empty())
+            {
+                return;
+            }
+
+            node::utils::checkSocketOptions(options);
+
+            //section level options reach local:// too, the tcp ones are not for unix sockets
+            config::ptree applicable;
+            for(const auto&[key, value] : options)
+            {
+                if(tcp || !node::utils::tcpSocketOption(key))
+                {
+                    applicable.push_back({key, value});
+                }
+            }
+
+            if(applicable.empty())
+            {
+                return;
+            }
+
+            idl::Configurable<> c = target;
+            if(!c)
+            {
+                LOGW("socket options are not supported by transport, ignored: "<<a.value);
+                return;
+            }
+
+            c->configure(config::cnvt(std::move(applicable))).value();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    transport::Address Node::fixAcceptorAddress(const transport::Address& a)
+    {
+        dci::utils::URI<> uri;
+        if(dci::utils::uri::parse(a.value, uri))
+        {
+            if(std::holds_alternative<dci::utils::uri::Inproc<>>(uri))
                 return transport::Address{fixAuto(a.value, node::utils::mkRandomName(32))};
 
             if(std::holds_alternative<dci::utils::uri::Local<>>(uri))
@@ -459,8 +1037,30 @@ namespace dci::module::ppn
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    transport::acceptor::Downstream<> Node::makeAcceptor(const transport::Address& a)
+    transport::acceptor::Downstream<> Node::makeAcceptor(const transport::Address& a, const config::ptree& options)
     {
+        if(_handoff)
+        {
+            List<transport::Channel<>> accepted;
+            if(transport::acceptor::Downstream<> res = node::Handoff::instance().adopt(a, accepted))
+            {
+                LOGI("acceptor adopted from handoff: "<<a.value<<", accepted meanwhile: "<<accepted.size());
+                for(transport::Channel<>& ch : accepted)
+                {
+                    _handoffAccepted.emplace_back(std::move(ch));
+                }
+                handoffAdmit();
+                return res;
+            }
+        }
+
+        if(node::Sim::is(a))
+        {
+            transport::inproc::Acceptor<> res = dciModuleEntry->manager()->createService<transport::inproc::Acceptor<>>().value();
+            res->bind(node::Sim::toCarrier(a)).value();
+            return transport::acceptor::Downstream<>(res);
+        }
+
         dci::utils::URI<> uri;
         if(!dci::utils::uri::parse(a.value, uri))
         {
@@ -474,6 +1074,7 @@ namespace dci::module::ppn
                               if constexpr(std::is_same_v<dci::utils::uri::TCP<>, Alt> || std::is_base_of_v<dci::utils::uri::TCP<>, Alt>)
                               {
                                   transport::net::Acceptor<> res = dciModuleEntry->manager()->createService<transport::net::Acceptor<>>().value();
+                                  applySocketOptions(idl::Interface{res}, a, options, true);
                                   res->bind(a).value();
                                   return transport::acceptor::Downstream<>(res);
                               }
@@ -481,6 +1082,7 @@ namespace dci::module::ppn
                               if constexpr(std::is_same_v<dci::utils::uri::Local<>, Alt>)
                               {
                                   transport::net::Acceptor<> res = dciModuleEntry->manager()->createService<transport::net::Acceptor<>>().value();
+                                  applySocketOptions(idl::Interface{res}, a, options, false);
                                   res->bind(a).value();
                                   return transport::acceptor::Downstream<>(res);
                               }
@@ -500,8 +1102,14 @@ namespace dci::module::ppn
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    transport::connector::Downstream<> Node::makeConnector(const transport::Address& a)
+    transport::connector::Downstream<> Node::makeConnector(const transport::Address& a, const config::ptree& options)
     {
+        if(node::Sim::is(a))
+        {
+            transport::inproc::Connector<> res = dciModuleEntry->manager()->createService<transport::inproc::Connector<>>().value();
+            return transport::connector::Downstream<>(res);
+        }
+
         dci::utils::URI<> uri;
         if(!dci::utils::uri::parse(a.value, uri))
         {
@@ -515,6 +1123,7 @@ namespace dci::module::ppn
                               if constexpr(std::is_same_v<dci::utils::uri::TCP<>, Alt> || std::is_base_of_v<dci::utils::uri::TCP<>, Alt>)
                               {
                                   transport::net::Connector<> res = dciModuleEntry->manager()->createService<transport::net::Connector<>>().value();
+                                  applySocketOptions(idl::Interface{res}, a, options, true);
                                   res->bind(a).value();
                                   return transport::connector::Downstream<>(res);
                               }
@@ -522,6 +1131,7 @@ namespace dci::module::ppn
                               if constexpr(std::is_same_v<dci::utils::uri::Local<>, Alt>)
                               {
                                   transport::net::Connector<> res = dciModuleEntry->manager()->createService<transport::net::Connector<>>().value();
+                                  applySocketOptions(idl::Interface{res}, a, options, false);
                                   res->bind(a).value();
                                   return transport::connector::Downstream<>(res);
                               }
@@ -540,212 +1150,1229 @@ namespace dci::module::ppn
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    void Node::csessionWorker(api::link::Id id, const transport::Address& a)
+    void Node::connectsRateTick(uint32 add)
     {
-        if(!_connectionsInProgress.insert(a).second)
+        int64 second = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+        //seconds passed without dials are zeroed, the whole ring at most
+        for(int64 i{_connectsRateSecond+1}; i<=second && i<=_connectsRateSecond+static_cast<int64>(_connectsRate.size()); ++i)
         {
-            //connection already in progress
-            return;
+            _connectsRate[static_cast<size_t>(i) % _connectsRate.size()] = 0;
         }
+        _connectsRateSecond = std::max(_connectsRateSecond, second);
 
-        api::feature::CSession<>::Opposite s{idl::interface::Initializer{}};
+        _connectsRate[static_cast<size_t>(_connectsRateSecond) % _connectsRate.size()] += add;
+    }
 
-        s->address() += [a]
-        {
-            return cmt::readyFuture(a);
-        };
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    api::SessionStats Node::sessionStats() const
+    {
+        api::SessionStats res;
+        res.connecting = _sessionsConnecting;
+        res.accepting = _sessionsAccepting;
+        res.acceptPending = static_cast<uint32>(_acceptPending.size());
+        res.joined = _sessionsJoined;
+        res.joinWaiters = static_cast<uint32>(_joinWaiters.size());
+        return res;
+    }
 
-        sbs::Owner sbsOwner4Id;
-        s->id() += sbsOwner4Id * [id]
-        {
-            return cmt::readyFuture(id);
-        };
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    api::Stats Node::stats()
+    {
+        connectsRateTick(0);
+
+        api::Stats res;
+        res.sessions = sessionStats();
 
-        utils::AtScopeExit sg{[&,this]
+        res.connects = _connectsStarted;
         {
-            if(s)
+            //the current second is partial and left out
+            uint64 sum{};
+            for(size_t i{}; i<_connectsRate.size(); ++i)
             {
-                s->closed();
+                if(i != static_cast<size_t>(_connectsRateSecond) % _connectsRate.size()) sum += _connectsRate[i];
             }
-            _connectionsInProgress.erase(a);
-        }};
-
-        _featureService->newSession(id, a, s.opposite());
-
-        transport::Channel<> ch;
-        try
-        {
-            ch = _connectors.hi()->connect(a).value();
-            _connectionsInProgress.erase(a);
-            s->connected();
+            res.connectsPerSecond = static_cast<uint32>((sum + _connectsWindow/2) / _connectsWindow);
         }
-        catch(const cmt::task::Stop&)
+        res.accepts = _acceptsStarted;
+
+        res.connectFailed = _connectFailed;
+        res.connectHandshakeFailed = _connectHandshakeFailed;
+        res.acceptHandshakeFailed = _acceptHandshakeFailed;
+        res.acceptDropped = _acceptDropped;
+        res.acceptRateLimited = _acceptRateLimited;
+        res.acceptBlocked = _acceptBlocked;
+        res.remotesEvicted = _remotesEvicted;
+        res.remotesRefused = _remotesRefused;
+        res.remotesIdleClosed = _remotesIdleClosed;
+        res.remotesDuplicate = _remotesDuplicate;
+
+        res.declared = static_cast<uint32>(_declaredLocalAddresses.size());
+        res.acceptors = static_cast<uint32>(_acceptors.loAmount());
+        res.connectors = static_cast<uint32>(_connectors.loAmount());
+
+        res.nattMappings = static_cast<uint32>(_nattMappings.size());
+        res.nattEstablished = 0;
+        res.nattRequestMs = 0;
+        res.nattEstablishMs = 0;
         {
-            auto e = exception::buildInstance<api::Error>("node stopped");
-            flushJoinWaiters(a, e);
-            s->failed(e);
-            return;
+            uint64 requestSum{}, establishSum{};
+            for(const auto&[g, m] : _nattMappings)
+            {
+                requestSum += static_cast<uint64>(m._requestLatency.count());
+                if(m._established)
+                {
+                    res.nattEstablished++;
+                    establishSum += static_cast<uint64>(m._establishLatency.count());
+                }
+            }
+
+            if(!_nattMappings.empty()) res.nattRequestMs = static_cast<uint32>(requestSum / _nattMappings.size());
+            if(res.nattEstablished) res.nattEstablishMs = static_cast<uint32>(establishSum / res.nattEstablished);
         }
-        catch(...)
+        res.nattPending = static_cast<uint32>(_nattPending.size());
+
+        res.agents = static_cast<uint32>(_agentRegistry.size());
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    List<api::RemoteInfo> Node::remotes(uint32 limit) const
+    {
+        using Iter = Map<api::link::Id, RemoteEntry>::const_iterator;
+
+        std::vector<Iter> iters;
+        iters.reserve(_remotes.size());
+        for(Iter iter = _remotes.begin(); iter != _remotes.end(); ++iter)
         {
-            auto e = exception::buildInstance<api::Error>(std::current_exception());
-            flushJoinWaiters(a, e);
-            s->failed(e);
-            return;
+            iters.push_back(iter);
         }
 
-        try
+        //busiest first, by received bytes
+        auto volume = [](const Iter& i) -> uint64
         {
-            api::link::Remote<> r = _link->joinByConnect(std::move(ch)).value();
-            api::link::Id id2 = r->id().value();
+            return i->second._traffic ? i->second._traffic->_bytes : 0;
+        };
 
-            if(id != id2)
-            {
-                sbsOwner4Id.flush();
-                s->id() += [id2]
-                {
-                    return cmt::readyFuture(id2);
-                };
+        size_t amount = limit ? std::min<size_t>(limit, iters.size()) : iters.size();
+        std::partial_sort(iters.begin(), iters.begin() + static_cast<std::ptrdiff_t>(amount), iters.end(), [&](const Iter& a, const Iter& b)
+        {
+            uint64 va = volume(a), vb = volume(b);
+            if(va != vb) return va > vb;
+            return a->second._joined < b->second._joined;
+        });
 
-                id = id2;
-                s->idSpecified(id);
-            }
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        List<api::RemoteInfo> res;
+        for(size_t i{}; i<amount; ++i)
+        {
+            const auto&[id, e] = *iters[i];
+
+            api::RemoteInfo& ri = res.emplace_back();
+            ri.id = id;
+            ri.byConnect = e._byConnect;
+            ri.scheme = e._scheme;
+            ri.handshake = e._handshake;
+            ri.bytesIn = e._traffic ? e._traffic->_bytes : 0;
+            ri.chunksIn = e._traffic ? e._traffic->_chunks : 0;
+            ri.uptime = static_cast<uint64>(std::chrono::duration_cast<std::chrono::seconds>(now - e._joined).count());
+        }
 
-            s->joined(r);
-            flushJoinWaiters(a, r);
-            _rdbInstance->addRemote(id2, r);
+        return res;
+    }
 
-            r->closed() += sol() * [s]() mutable
-            {
-                s->closed();
-            };
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::exportMetrics()
+    {
+        api::Stats s = stats();
+
+        std::ostringstream out;
+        using E = node::Exporter;
+
+        E::gauge(out, "ppn_node_sessions_connecting", "Outbound sessions dialing or in handshake.", s.sessions.connecting);
+        E::gauge(out, "ppn_node_sessions_accepting", "Inbound sessions in handshake.", s.sessions.accepting);
+        E::gauge(out, "ppn_node_sessions_accept_pending", "Accepted channels waiting for a handshake slot.", s.sessions.acceptPending);
+        E::gauge(out, "ppn_node_remotes", "Joined remotes.", s.sessions.joined);
+        E::gauge(out, "ppn_node_join_waiters", "Join requests waiting for a session.", s.sessions.joinWaiters);
+
+        E::counter(out, "ppn_node_connects_total", "Dials started.", s.connects);
+        E::gauge(out, "ppn_node_connects_per_second", "Dials started per second, averaged over the last 10 full seconds.", s.connectsPerSecond);
+        E::counter(out, "ppn_node_accepts_total", "Channels accepted.", s.accepts);
+        E::counter(out, "ppn_node_connect_failed_total", "Dials refused or timed out by the transport.", s.connectFailed);
+        E::counter(out, "ppn_node_connect_handshake_failed_total", "Outbound handshakes failed.", s.connectHandshakeFailed);
+        E::counter(out, "ppn_node_accept_handshake_failed_total", "Inbound handshakes failed.", s.acceptHandshakeFailed);
+        E::counter(out, "ppn_node_accept_dropped_total", "Accepted channels dropped on pending queue overflow.", s.acceptDropped);
+        E::counter(out, "ppn_node_accept_rate_limited_total", "Accepted channels dropped by the per source rate limit.", s.acceptRateLimited);
+        E::counter(out, "ppn_node_accept_blocked_total", "Accepted channels dropped by the source blocklist.", s.acceptBlocked);
+        E::counter(out, "ppn_node_remotes_evicted_total", "Remotes closed to make room under the remotes cap.", s.remotesEvicted);
+        E::counter(out, "ppn_node_remotes_refused_total", "Sessions refused before handshake, no room under the remotes cap.", s.remotesRefused);
+        E::counter(out, "ppn_node_remotes_idle_closed_total", "Remotes closed by the idle reaper.", s.remotesIdleClosed);
+        E::counter(out, "ppn_node_remotes_duplicate_total", "Duplicate remotes of one id resolved to a single one.", s.remotesDuplicate);
+        E::histogram(out, "ppn_node_join_duration_microseconds", "Time from dial or accept to join.", joinBounds, _joinBuckets.data(), _joinBuckets.size(), _joinSum);
+
+        E::gauge(out, "ppn_node_declared_addresses", "Declared local addresses.", s.declared);
+        E::gauge(out, "ppn_node_acceptors", "Live acceptors.", s.acceptors);
+        E::gauge(out, "ppn_node_connectors", "Live connectors.", s.connectors);
+        E::gauge(out, "ppn_node_net_links", "Network links seen by the net enumerator.", _netEnumerator ? _netEnumerator->linksAmount() : 0);
+        E::gauge(out, "ppn_node_net_addresses", "Local addresses seen by the net enumerator.", _netEnumerator ? _netEnumerator->addressesAmount() : 0);
+
+        E::gauge(out, "ppn_node_natt_mappings", "NAT mappings.", s.nattMappings);
+        E::gauge(out, "ppn_node_natt_established", "NAT mappings confirmed by the gateway.", s.nattEstablished);
+        E::gauge(out, "ppn_node_natt_pending", "NAT mappings requested and not answered yet.", s.nattPending);
+        E::gauge(out, "ppn_node_natt_request_ms", "Mean time from a NAT mapping request to its creation, milliseconds.", s.nattRequestMs);
+        E::gauge(out, "ppn_node_natt_establish_ms", "Mean time from a NAT mapping request to the gateway confirmation, milliseconds.", s.nattEstablishMs);
+
+        E::gauge(out, "ppn_node_agents", "Registered agent providers.", s.agents);
+
+        _exporter->publish(out.str());
+    }
 
-            s.reset();
-        }
-        catch(const cmt::task::Stop&)
+    namespace
+    {
+        String schemeOf(const transport::Address& a)
         {
-            auto e = exception::buildInstance<api::Error>("node stopped");
-            flushJoinWaiters(a, e);
-            s->failed(e);
-            return;
+            size_t pos = a.value.find("://");
+            return a.value.npos == pos ? String{} : a.value.substr(0, pos);
         }
-        catch(...)
+
+        template <class T>
+        ExceptionPtr failure(cmt::Future<T>& in)
         {
-            auto e = exception::buildInstance<api::Error>(std::current_exception());
-            flushJoinWaiters(a, e);
-            s->failed(e);
-            return;
+            if(in.resolvedException())
+            {
+                return exception::buildInstance<api::Error>(in.detachException());
+            }
+
+            return exception::buildInstance<api::Error>("canceled");
         }
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    void Node::asessionWorker(transport::Channel<>&& ch)
+    std::shared_ptr<Node::Traffic> Node::trafficWatch(transport::Channel<>& ch)
     {
-        api::feature::ASession<>::Opposite s{idl::interface::Initializer{}};
+        std::shared_ptr<Traffic> res = std::make_shared<Traffic>();
+        res->_last = std::chrono::steady_clock::now();
 
-        s->address() += [removeAddress=ch->remoteAddress()] () mutable
+        //subscribed ahead of the link, so the link still gets the data untouched
+        ch->received() += sol() * [t=res](const Bytes& data)
         {
-            return removeAddress;
+            t->_bytes += data.size();
+            t->_chunks++;
+            t->_last = std::chrono::steady_clock::now();
         };
 
-        sbs::Owner sbsOwner4Id;
-        s->id() += sbsOwner4Id * []
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Node::CSessionState::CSessionState(Node* node, const api::link::Id& id, const transport::Address& a)
+        : _node{node}
+        , _id{id}
+        , _address{a}
+        , _begin{std::chrono::steady_clock::now()}
+    {
+        _node->_csessions.insert(this);
+        _node->_sessionsConnecting++;
+
+        _s->address() += [a]
         {
-            return cmt::readyFuture(api::link::Id{});
+            return cmt::readyFuture(a);
         };
 
-        utils::AtScopeExit sg{[&]
+        _s->id() += _sbsOwner4Id * [id]
         {
-            if(s)
-            {
-                s->closed();
-            }
-        }};
+            return cmt::readyFuture(id);
+        };
+    }
 
-        api::feature::Acceptors<>::Opposite{_featureService}->newSession(s.opposite());
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Node::CSessionState::~CSessionState()
+    {
+        //accounting only, an unfinished session is failed by Node::sessionsCancel before its continuation is dropped
+        _node->_csessions.erase(this);
+        _node->_sessionsConnecting--;
+    }
 
-        try
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::CSessionState::fail(ExceptionPtr e)
+    {
+        if(_connecting)
         {
-            api::link::Remote<> r = _link->joinByAccept(std::move(ch)).value();
-            api::link::Id id = r->id().value();
+            _connecting = false;
+            _node->_connectionsInProgress.erase(_address);
+        }
 
-            sbsOwner4Id.flush();
-            s->id() += [id]
-            {
-                return cmt::readyFuture(id);
-            };
+        _node->flushJoinWaiters(_address, e);
+
+        if(_s)
+        {
+            _s->failed(e);
+            _s->closed();
+            _s.reset();
+        }
+    }
 
-            s->idSpecified(id);
-            s->joined(r);
-            _rdbInstance->addRemote(id, r);
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Node::ASessionState::ASessionState(Node* node, cmt::Future<transport::Address>&& remoteAddress)
+        : _node{node}
+        , _remoteAddress{std::move(remoteAddress)}
+        , _begin{std::chrono::steady_clock::now()}
+    {
+        _node->_asessions.insert(this);
+        _node->_sessionsAccepting++;
+        _node->_acceptWorkersActive++;
 
-            r->closed() += sol() * [s]() mutable
-            {
-                s->closed();
-            };
+        _s->address() += [remoteAddress=_remoteAddress] () mutable
+        {
+            return remoteAddress;
+        };
 
-            s.reset();
-        }
-        catch(const cmt::task::Stop&)
+        _s->id() += _sbsOwner4Id * []
         {
-            s->failed(exception::buildInstance<api::Error>("node stopped"));
-        }
-        catch(...)
+            return cmt::readyFuture(api::link::Id{});
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Node::ASessionState::~ASessionState()
+    {
+        //accounting only, an unfinished session is failed by Node::sessionsCancel before its continuation is dropped
+        _node->_asessions.erase(this);
+        _node->_sessionsAccepting--;
+
+        if(_worker)
         {
-            s->failed(exception::buildInstance<api::Error>(std::current_exception()));
+            _node->_acceptWorkersActive--;
         }
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    void Node::flushJoinWaiters(const transport::Address& a, ExceptionPtr e)
+    void Node::ASessionState::fail(ExceptionPtr e)
     {
-        for(auto iter{_joinWaiters.lower_bound(a)}; iter != _joinWaiters.end() && iter->first == a; )
+        if(_s)
         {
-            iter->second.resolveException(e);
-            iter = _joinWaiters.erase(iter);
+            _s->failed(e);
+            _s->closed();
+            _s.reset();
         }
+
+        release();
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    void Node::flushJoinWaiters(const transport::Address& a, api::link::Remote<> r)
+    void Node::ASessionState::release()
     {
-        for(auto iter{_joinWaiters.lower_bound(a)}; iter != _joinWaiters.end() && iter->first == a; )
+        if(_worker)
         {
-            iter->second.resolveValue(r);
-            iter = _joinWaiters.erase(iter);
+            _worker = false;
+            _node->_acceptWorkersActive--;
+            _node->asessionNext();
         }
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    Node::Mapping::Mapping(Node* node, transport::natt::Mapping<>&& api, const transport::Address& internal)
-        : _node{node}
-        , _api{std::move(api)}
+    void Node::sessionsCancel()
     {
-        _api->established() += _sbsOwner * [internal,this](const transport::Address& external)
+        ExceptionPtr e = exception::buildInstance<api::Error>("node stopped");
+
+        //copied, failing reenters features which may finish other sessions
+        for(CSessionState* cs : std::vector<CSessionState*>{_csessions.begin(), _csessions.end()})
         {
+            if(_csessions.contains(cs)) cs->fail(e);
+        }
+
+        for(ASessionState* as : std::vector<ASessionState*>{_asessions.begin(), _asessions.end()})
+        {
+            if(_asessions.contains(as)) as->fail(e);
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::csessionWorker(api::link::Id id, const transport::Address& a)
+    {
+        if(!_started)
+        {
+            flushJoinWaiters(a, exception::buildInstance<api::Error>("node stopped"));
+            return;
+        }
+
+        if(_draining)
+        {
+            flushJoinWaiters(a, exception::buildInstance<api::Error>("node draining"));
+            return;
+        }
+
+        if(_connectionsInProgress.contains(a))
+        {
+            //connection already in progress
+            return;
+        }
+
+        if(!remotesCapAdmit(true))
+        {
+            flushJoinWaiters(a, exception::buildInstance<api::Error>("remotes cap reached"));
+            return;
+        }
+
+        _connectionsInProgress.insert(a);
+        _connectsStarted++;
+        connectsRateTick(1);
+
+        std::shared_ptr<CSessionState> cs = std::make_shared<CSessionState>(this, id, a);
+
+        _featureService->newSession(id, a, cs->_s.opposite());
+
+        if(node::Sim::is(a))
+        {
+            //on the fiber of the feature entry point, injected delays sleep right here
+            node::Sim::Outcome outcome;
+            try
+            {
+                outcome = _sim.dial(cs->_address);
+            }
+            catch(const cmt::task::Stop&)
+            {
+                return;
+            }
+            catch(...)
+            {
+                _connectFailed++;
+                cs->fail(exception::buildInstance<api::Error>(std::current_exception()));
+                return;
+            }
+
+            if(node::Sim::Outcome::hang == outcome)
+            {
+                //a real channel left silent, the peer sees a half-open connection
+                try
+                {
+                    transport::Channel<> ch = _connectors.hi()->connect(node::Sim::toCarrier(cs->_address)).value();
+                    _sim.hang();
+                }
+                catch(const cmt::task::Stop&)
+                {
+                    return;
+                }
+                catch(...)
+                {
+                }
+
+                _connectFailed++;
+                cs->fail(exception::buildInstance<api::Error>("sim: connection hung: "+cs->_address.value));
+                return;
+            }
+        }
+
+        csessionConnect(std::move(cs));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::csessionConnect(std::shared_ptr<CSessionState> cs)
+    {
+        const transport::Address& a = cs->_address;
+
+        cmt::Future<transport::Channel<>> connecting;
+        if(node::Sim::is(a))
+        {
+            connecting = _connectors.hi()->connect(node::Sim::toCarrier(a));
+        }
+        else
+        {
+            //keep peers on the links of their own reach, lan peers via lan interfaces etc.
+            transport::connector::Downstream<> scoped;
+            if(_connectMatchScope)
+            {
+                scoped = _connectors.loForTarget(a);
+            }
+
+            connecting = scoped ? scoped->connect(a) : _connectors.hi()->connect(a);
+        }
+
+        connecting.then() += sol() * [cs=std::move(cs), this](cmt::Future<transport::Channel<>> in) mutable
+        {
+            if(!in.resolvedValue())
+            {
+                _connectFailed++;
+                cs->fail(failure(in));
+                return;
+            }
+
+            _connectionsInProgress.erase(cs->_address);
+            cs->_connecting = false;
+            cs->_s->connected();
+
+            csessionJoin(std::move(cs), in.detachValue());
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::csessionJoin(std::shared_ptr<CSessionState> cs, transport::Channel<>&& ch)
+    {
+        cs->_traffic = trafficWatch(ch);
+
+        _link->joinByConnect(std::move(ch)).then() += sol() * [cs=std::move(cs), this](cmt::Future<api::link::Remote<>> in) mutable
+        {
+            if(!in.resolvedValue())
+            {
+                _connectHandshakeFailed++;
+                cs->fail(failure(in));
+                return;
+            }
+
+            api::link::Remote<> r = in.detachValue();
+            r->id().then() += sol() * [cs=std::move(cs), r, this](cmt::Future<api::link::Id> in) mutable
+            {
+                if(!in.resolvedValue())
+                {
+                    _connectHandshakeFailed++;
+                    cs->fail(failure(in));
+                    return;
+                }
+
+                api::link::Id id2 = in.detachValue();
+                if(cs->_id != id2)
+                {
+                    cs->_sbsOwner4Id.flush();
+                    cs->_s->id() += [id2]
+                    {
+                        return cmt::readyFuture(id2);
+                    };
+
+                    cs->_id = id2;
+                    cs->_s->idSpecified(id2);
+                }
+
+                if(!remoteDuplicateResolve(id2, true))
+                {
+                    //the remote already joined stays, join waiters get it
+                    if(auto iter = _remotes.find(id2); _remotes.end() != iter)
+                    {
+                        flushJoinWaiters(cs->_address, iter->second._remote);
+                    }
+
+                    r->close();
+                    cs->fail(exception::buildInstance<api::Error>("duplicate remote"));
+                    return;
+                }
+
+                try
+                {
+                    cs->_s->joined(r);
+                    flushJoinWaiters(cs->_address, r);
+                    _rdbInstance->addRemote(id2, r);
+                    remoteJoined(id2, r, std::move(cs->_s), cs->_address, true, cs->_begin, cs->_traffic);
+                }
+                catch(...)
+                {
+                    cs->fail(exception::buildInstance<api::Error>(std::current_exception()));
+                }
+            };
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::asessionWorker(transport::Channel<>&& ch)
+    {
+        if(!remotesCapAdmit(false))
+        {
+            //dropped before any handshake work is spent on it
+            return;
+        }
+
+        std::shared_ptr<ASessionState> as = std::make_shared<ASessionState>(this, ch->remoteAddress());
+
+        api::feature::Acceptors<>::Opposite{_featureService}->newSession(as->_s.opposite());
+
+        as->_traffic = trafficWatch(ch);
+
+        _link->joinByAccept(std::move(ch)).then() += sol() * [as=std::move(as), this](cmt::Future<api::link::Remote<>> in) mutable
+        {
+            if(!in.resolvedValue())
+            {
+                _acceptHandshakeFailed++;
+                as->fail(failure(in));
+                return;
+            }
+
+            api::link::Remote<> r = in.detachValue();
+            r->id().then() += sol() * [as=std::move(as), r, this](cmt::Future<api::link::Id> in) mutable
+            {
+                if(!in.resolvedValue())
+                {
+                    _acceptHandshakeFailed++;
+                    as->fail(failure(in));
+                    return;
+                }
+
+                api::link::Id id = in.detachValue();
+
+                as->_sbsOwner4Id.flush();
+                as->_s->id() += [id]
+                {
+                    return cmt::readyFuture(id);
+                };
+
+                as->_s->idSpecified(id);
+
+                if(!remoteDuplicateResolve(id, false))
+                {
+                    r->close();
+                    as->fail(exception::buildInstance<api::Error>("duplicate remote"));
+                    return;
+                }
+
+                try
+                {
+                    as->_s->joined(r);
+                    _rdbInstance->addRemote(id, r);
+                    remoteJoined(id, r, std::move(as->_s), as->_remoteAddress.resolvedValue() ? as->_remoteAddress.value() : transport::Address{}, false, as->_begin, as->_traffic);
+                }
+                catch(...)
+                {
+                    as->fail(exception::buildInstance<api::Error>(std::current_exception()));
+                    return;
+                }
+
+                as->release();
+            };
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::asessionAdmit(transport::Channel<>&& ch)
+    {
+        if(_draining)
+        {
+            return;
+        }
+
+        if(_probing.empty() && _probeSources.empty() && !_sourceLimiter.active())
+        {
+            _acceptsStarted++;
+            asessionQueue(std::move(ch));
+            return;
+        }
+
+        cmt::Future<transport::Address> remoteAddress = ch->remoteAddress();
+        remoteAddress.then() += sol() * [ch=std::move(ch), this](cmt::Future<transport::Address> in) mutable
+        {
+            if(!in.resolvedValue())
+            {
+                //channel gone already
+                return;
+            }
+
+            asessionScreen(std::move(ch), in.detachValue());
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::asessionScreen(transport::Channel<>&& ch, transport::Address&& remote)
+    {
+        if(_draining)
+        {
+            return;
+        }
+
+        //own self-probe, dropped before it is counted, limited or given a worker
+        if(_probeSources.erase(remote))
+        {
+            return;
+        }
+
+        //may be a probe whose connect has not resolved on the dialing side yet, held shortly and boundedly
+        if(probeCandidate(remote) && _probeHeld.size() < _probeHeldMax)
+        {
+            _probeHeld.emplace_back(std::move(ch), std::move(remote));
+            if(_probeHeldTimer && 1 == _probeHeld.size())
+            {
+                _probeHeldTimer->start();
+            }
+            return;
+        }
+
+        asessionPass(std::move(ch), remote);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::asessionPass(transport::Channel<>&& ch, const transport::Address& remote)
+    {
+        _acceptsStarted++;
+
+        if(_sourceLimiter.active())
+        {
+            switch(_sourceLimiter.admit(remote))
+            {
+            case node::SourceLimiter::Verdict::blocked:
+                _acceptBlocked++;
+                return;
+
+            case node::SourceLimiter::Verdict::limited:
+                _acceptRateLimited++;
+                return;
+
+            case node::SourceLimiter::Verdict::pass:
+                break;
+            }
+        }
+
+        asessionQueue(std::move(ch));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::asessionQueue(transport::Channel<>&& ch)
+    {
+        if(_acceptWorkers && _acceptWorkersActive >= _acceptWorkers)
+        {
+            if(_acceptPending.size() >= _acceptPendingMax)
+            {
+                //overloaded, drop the channel before any handshake work is spent on it
+                _acceptDropped++;
+                return;
+            }
+
+            _acceptPending.emplace_back(std::move(ch));
+            return;
+        }
+
+        asessionWorker(std::move(ch));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::asessionNext()
+    {
+        if(_acceptDraining)
+        {
+            //a handshake finished right inside the loop below, the loop picks up the next one
+            return;
+        }
+
+        _acceptDraining = true;
+        utils::AtScopeExit sg{[this]
+        {
+            _acceptDraining = false;
+        }};
+
+        while(_started && !_acceptPending.empty() && (!_acceptWorkers || _acceptWorkersActive < _acceptWorkers))
+        {
+            transport::Channel<> ch = std::move(_acceptPending.front());
+            _acceptPending.pop_front();
+            asessionWorker(std::move(ch));
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class SessionOpposite>
+    void Node::remoteJoined(const api::link::Id& id, const api::link::Remote<>& r, SessionOpposite&& s, const transport::Address& a, bool byConnect, std::chrono::steady_clock::time_point begin, std::shared_ptr<Traffic> traffic)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        uint64 duration = static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(now - begin).count());
+
+        _sessionsJoined++;
+
+        uint64 serial = ++_remotesSerial;
+        RemoteEntry& entry = _remotes[id];
+        entry._serial = serial;
+        entry._remote = r;
+        entry._byConnect = byConnect;
+        entry._scheme = schemeOf(a);
+        entry._handshake = duration;
+        entry._joined = now;
+        entry._active = now;
+        entry._traffic = std::move(traffic);
+        entry._closing = false;
+
+        if(_idleTimer)
+        {
+            _idleWheel.schedule(id, serial, now + _idleWheel.timeout(), now);
+        }
+
+        _joinBuckets[static_cast<size_t>(std::lower_bound(std::begin(joinBounds), std::end(joinBounds), duration) - std::begin(joinBounds))]++;
+        _joinSum += duration;
+
+        //the only per-remote subscription, holds the session until the remote is closed
+        (byConnect ? _remotesOutbound : _remotesInbound)++;
+
+        r->closed() += sol() * [id, serial, byConnect, s=std::move(s), this]() mutable
+        {
+            if(!_remotesEvicting.erase(serial))
+            {
+                (byConnect ? _remotesOutbound : _remotesInbound)--;
+            }
+            _sessionsJoined--;
+
+            if(auto iter = _remotes.find(id); _remotes.end() != iter && serial == iter->second._serial)
+            {
+                _remotes.erase(iter);
+            }
+
+            s->closed();
+            (*this)->remoteClosed(id);
+        };
+
+        (*this)->remoteJoined(id, byConnect, duration);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Node::remotesCapAdmit(bool byConnect)
+    {
+        if(!_remotesMax)
+        {
+            return true;
+        }
+
+        //handshakes in flight hold their slots too
+        uint32 outbound = _remotesOutbound + _sessionsConnecting;
+        uint32 inbound = _remotesInbound + _sessionsAccepting;
+
+        //own direction may take all but the slots reserved for the other one
+        uint32 own = byConnect ? outbound : inbound;
+        uint32 ownShare = _remotesMax - (byConnect ? _remotesInboundReserve : _remotesOutboundReserve);
+
+        bool admitted = true;
+        if(own >= ownShare)
+        {
+            //own share is full, room is made inside it
+            admitted = remotesEvict(byConnect);
+        }
+        else if(inbound + outbound >= _remotesMax)
+        {
+            //over the cap with own direction in its share, the other one is over its reservation
+            admitted = remotesEvict(!byConnect);
+        }
+
+        if(!admitted)
+        {
+            _remotesRefused++;
+        }
+
+        return admitted;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Node::remoteDuplicateResolve(const api::link::Id& id, bool byConnect)
+    {
+        auto iter = _remotes.find(id);
+        if(_remotes.end() == iter)
+        {
+            return true;
+        }
+
+        _remotesDuplicate++;
+
+        RemoteEntry& e = iter->second;
+        bool keepNew = node::utils::duplicateKeepNew(e._byConnect, e._closing, byConnect, _ownId < id);
+
+        if(keepNew && !e._closing)
+        {
+            e._closing = true;
+            api::link::Remote<> r = e._remote;
+            r->close();
+        }
+
+        return keepNew;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::remoteTouch(const api::link::Id& id)
+    {
+        //demand from features, received data is seen by trafficWatch
+        if(auto iter = _remotes.find(id); _remotes.end() != iter)
+        {
+            iter->second._active = std::chrono::steady_clock::now();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::idleTick()
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for(const auto&[id, serial] : _idleWheel.advance())
+        {
+            auto iter = _remotes.find(id);
+            if(_remotes.end() == iter || serial != iter->second._serial)
+            {
+                //closed or replaced meanwhile
+                continue;
+            }
+
+            //demand from features or data received on the channel, whichever is later
+            std::chrono::steady_clock::time_point active = lastActive(iter->second);
+            if(now - active < _idleWheel.timeout())
+            {
+                _idleWheel.schedule(id, serial, active + _idleWheel.timeout(), now);
+                continue;
+            }
+
+            if(iter->second._closing)
+            {
+                continue;
+            }
+
+            _remotesIdleClosed++;
+            iter->second._closing = true;
+            api::link::Remote<> r = iter->second._remote;
+            r->close();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Node::remotesEvict(bool byConnect)
+    {
+        RemoteEntry* victim{};
+        auto consider = [&](auto better)
+        {
+            for(auto&[id, e] : _remotes)
+            {
+                if(e._byConnect == byConnect && !e._closing && (!victim || better(e, *victim))) victim = &e;
+            }
+        };
+
+        switch(_remotesEvict)
+        {
+        case RemotesEvict::none:
+            return false;
+
+        case RemotesEvict::lru:
+            consider([](const RemoteEntry& a, const RemoteEntry& b){return lastActive(a) < lastActive(b);});
+            break;
+
+        case RemotesEvict::oldest:
+            consider([](const RemoteEntry& a, const RemoteEntry& b){return a._joined < b._joined;});
+            break;
+
+        case RemotesEvict::slowest:
+            consider([](const RemoteEntry& a, const RemoteEntry& b){return a._handshake > b._handshake;});
+            break;
+        }
+
+        if(!victim)
+        {
+            return false;
+        }
+
+        //the slot is free from now, the close arrives later and must not free it twice
+        _remotesEvicting.insert(victim->_serial);
+        (byConnect ? _remotesOutbound : _remotesInbound)--;
+        _remotesEvicted++;
+
+        victim->_closing = true;
+        api::link::Remote<> r = victim->_remote;
+        r->close();
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::chrono::steady_clock::time_point Node::lastActive(const RemoteEntry& e)
+    {
+        return e._traffic ? std::max(e._active, e._traffic->_last) : e._active;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::flushJoinWaiters(const transport::Address& a, ExceptionPtr e)
+    {
+        for(cmt::Promise<api::link::Remote<>>& p : extractJoinWaiters(a))
+        {
+            p.resolveException(e);
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::flushJoinWaiters(const transport::Address& a, api::link::Remote<> r)
+    {
+        for(cmt::Promise<api::link::Remote<>>& p : extractJoinWaiters(a))
+        {
+            p.resolveValue(r);
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    List<cmt::Promise<api::link::Remote<>>> Node::extractJoinWaiters(const transport::Address& a)
+    {
+        //extracted before resolving, resolution may reenter and rehash the container
+        List<cmt::Promise<api::link::Remote<>>> res;
+
+        auto range = _joinWaiters.equal_range(a);
+        for(auto iter{range.first}; iter != range.second; )
+        {
+            res.emplace_back(std::move(iter->second));
+            iter = _joinWaiters.erase(iter);
+        }
+
+        return res;
+    }
+
+    namespace
+    {
+        constexpr char nattStatePrefix[] = "natt.";
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    String Node::nattGroup(const transport::Address& internal)
+    {
+        //acceptors on several interfaces with the same port share one gateway mapping,
+        //loopback and link-local ones are never mapped by a gateway, a wildcard bind is
+        String port = internal.value.substr(internal.value.rfind(':')+1);
+        if(port.empty() || port.npos != port.find_first_not_of("0123456789"))
+        {
+            return String{};
+        }
+
+        if(internal.value.starts_with("tcp4://0.0.0.0:")) return "tcp4.any." + port;
+        if(internal.value.starts_with("tcp6://[::]:")) return "tcp6.any." + port;
+
+        uint32 scope = node::utils::addressScope(internal);
+
+        const char* reach;
+        if(scope & static_cast<uint32>(dci::utils::ip::Scope::lan)) reach = "lan";
+        else if(scope & static_cast<uint32>(dci::utils::ip::Scope::wan)) reach = "wan";
+        else return String{};
+
+        const char* family = (scope & static_cast<uint32>(dci::utils::ip::Scope::ip4)) ? "tcp4" : "tcp6";
+        return String{family} + "." + reach + "." + port;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::nattAttach(const transport::Address& internal)
+    {
+        String group = nattGroup(internal);
+        if(group.empty())
+        {
+            return;
+        }
+
+        node::utils::AddressSet& members = _nattMembers[group];
+        members.insert(internal);
+
+        //restored before acceptors came up, for an address none of them took this time (dhcp changed it etc.)
+        auto mappingIter = _nattMappings.find(group);
+        if(_nattMappings.end() != mappingIter && !members.contains(mappingIter->second._internal))
+        {
+            LOGI("natt retargeting "<<mappingIter->second._internal.value<<" -> "<<internal.value);
+            nattForget(mappingIter->second);
+            _nattMappings.erase(mappingIter);
+        }
+
+        nattRequest(group, internal);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::nattDetach(const transport::Address& internal)
+    {
+        String group = nattGroup(internal);
+
+        auto membersIter = _nattMembers.find(group);
+        if(_nattMembers.end() == membersIter)
+        {
+            return;
+        }
+
+        node::utils::AddressSet& members = membersIter->second;
+        members.erase(internal);
+
+        if(members.empty())
+        {
+            _nattMembers.erase(membersIter);
+            _nattMappings.erase(group);
+            _nattPending.erase(group);
+            return;
+        }
+
+        //the mapping was made for the gone address, move it to one of the rest
+        auto mappingIter = _nattMappings.find(group);
+        if(_nattMappings.end() != mappingIter && mappingIter->second._internal.value == internal.value)
+        {
+            _nattMappings.erase(mappingIter);
+            nattRequest(group, *members.begin());
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::nattRequest(const String& group, const transport::Address& internal)
+    {
+        if(!_natt)
+        {
+            return;
+        }
+
+        if(_nattMappings.contains(group) || _nattPending.contains(group))
+        {
+            return;
+        }
+
+        uint64 serial = ++_nattSerial;
+        _nattPending[group] = serial;
+
+        std::chrono::steady_clock::time_point requested = std::chrono::steady_clock::now();
+        _natt->mapping().then() += sol() * [=,this](cmt::Future<transport::natt::Mapping<>> in)
+        {
+            if(!_started) return;
+
+            //detached meanwhile, or requested again after that
+            auto pendingIter = _nattPending.find(group);
+            if(_nattPending.end() == pendingIter || serial != pendingIter->second) return;
+            _nattPending.erase(pendingIter);
+
+            if(in.resolvedValue())
+            {
+                //the address asked for may have gone while the request was in flight
+                transport::Address target = internal;
+                auto membersIter = _nattMembers.find(group);
+                if(_nattMembers.end() != membersIter && !membersIter->second.contains(internal))
+                {
+                    target = *membersIter->second.begin();
+                }
+
+                _nattMappings.emplace(std::piecewise_construct_t{},
+                                      std::tie(group),
+                                      std::forward_as_tuple(this, group, in.detachValue(), target, requested));
+            }
+            else if(in.resolvedException())
+            {
+                LOGW("mapping failed: "<<exception::toString(in.detachException()));
+            }
+            else //if(in.resolvedCancel())
+            {
+                LOGW("mapping canceled");
+            }
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::nattRestore()
+    {
+        if(!_natt)
+        {
+            return;
+        }
+
+        _nattTimer.start();
+
+        if(!_nattPersist)
+        {
+            return;
+        }
+
+        //the gateway lease is not known to the node, so a remembered external is
+        //only a hint: the mapping is requested again and declared once confirmed
+        for(const auto&[key, value] : _state.prefixed(nattStatePrefix))
+        {
+            String group = key.substr(sizeof(nattStatePrefix)-1);
+
+            transport::Address internal;
+            transport::Address external;
+            std::istringstream{value} >> internal.value >> external.value;
+
+            if(internal.value.empty() || group != nattGroup(internal))
+            {
+                _state.erase(key);
+                continue;
+            }
+
+            LOGI("natt restoring "<<internal.value<<" <- "<<external.value);
+            nattRequest(group, internal);
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::nattPersist(const Mapping& m)
+    {
+        if(_nattPersist)
+        {
+            _state.set(nattStatePrefix + m._group, m._internal.value + " " + m._external.value);
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::nattForget(const Mapping& m)
+    {
+        _state.erase(nattStatePrefix + m._group);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Node::nattTick()
+    {
+        auto now = std::chrono::system_clock::now();
+
+        for(auto iter{_nattMappings.begin()}; iter != _nattMappings.end(); )
+        {
+            Mapping& m = iter->second;
+
+            //restored mapping for a port no acceptor took this time
+            if(!_nattMembers.contains(iter->first) && now - m._created > _nattBindGrace)
+            {
+                LOGI("natt dropped stale "<<m._internal.value);
+                nattForget(m);
+                iter = _nattMappings.erase(iter);
+                continue;
+            }
+
+            ++iter;
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Node::Mapping::Mapping(
+            Node* node,
+            const String& group,
+            transport::natt::Mapping<>&& api,
+            const transport::Address& internal,
+            std::chrono::steady_clock::time_point requested)
+        : _node{node}
+        , _api{std::move(api)}
+        , _group{group}
+        , _internal{internal}
+        , _created{std::chrono::system_clock::now()}
+        , _requested{requested}
+        , _requestLatency{std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - requested)}
+    {
+        _api->established() += _sbsOwner * [this](const transport::Address& external)
+        {
+            if(!_established && _establishLatency == std::chrono::milliseconds{})
+            {
+                _establishLatency = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _requested);
+                LOGI("natt latency "<<_internal.value<<": request "<<_requestLatency.count()<<"ms, establish "<<_establishLatency.count()<<"ms");
+            }
+            _established = true;
+
+            if(_external.value == external.value)
+            {
+                return;
+            }
+
+            if(!_external.value.empty())
+            {
+                LOGI("natt unmapped "<<_internal.value<<" <- "<<_external.value);
+                _node->localAddressUndeclare(_external);
+            }
+            _external = external;
             if(!_external.value.empty())
             {
-                LOGI("natt unmapped "<<internal.value<<" <- "<<_external.value);
-                _node->localAddressUndeclare(_external);
-            }
-            _external = external;
-            if(!_external.value.empty())
-            {
-                LOGI("natt mapped "<<internal.value<<" <- "<<_external.value);
+                LOGI("natt mapped "<<_internal.value<<" <- "<<_external.value);
                 _node->localAddressDeclare(external);
+                _node->nattPersist(*this);
+            }
+            else
+            {
+                _node->nattForget(*this);
             }
         };
 
-        _api->unestablished() += _sbsOwner * [internal,this]()
+        _api->unestablished() += _sbsOwner * [this]()
         {
+            _established = false;
+            _node->nattForget(*this);
+
             if(!_external.value.empty())
             {
-                LOGI("natt unmapped "<<internal.value<<" <- "<<_external.value);
+                LOGI("natt unmapped "<<_internal.value<<" <- "<<_external.value);
                 _node->localAddressUndeclare(std::exchange(_external, {}));
             }
         };
 
-        _api.involvedChanged() += _sbsOwner * [internal,this](bool v)
+        _api.involvedChanged() += _sbsOwner * [this](bool v)
         {
             if(!v)
             {
@@ -753,13 +2380,13 @@ namespace dci::module::ppn
                 _api.reset();
                 if(!_external.value.empty())
                 {
-                    LOGI("natt unmapped "<<internal.value<<" <- "<<_external.value);
+                    LOGI("natt unmapped "<<_internal.value<<" <- "<<_external.value);
                     _node->localAddressUndeclare(std::exchange(_external, {}));
                 }
             }
         };
 
-        _api->start(internal, transport::natt::Protocol::tcp);
+        _api->start(_internal, transport::natt::Protocol::tcp);
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
@@ -10,6 +10,13 @@
 #include "pch.hpp"
 #include "node/netEnumerator.hpp"
 #include "node/transportHub.hpp"
+#include "node/sim.hpp"
+#include "node/exporter.hpp"
+#include "node/sourceLimiter.hpp"
+#include "node/declaredJournal.hpp"
+#include "node/idleWheel.hpp"
+#include "node/handoff.hpp"
+#include "node/utils.hpp"
 
 namespace dci::module::ppn
 {
@@ -24,6 +31,12 @@ namespace dci::module::ppn
         void start(idl::Config&& config);
         void stop();
 
+        //stop accepting, undeclare, let handshakes finish and close remotes in paced batches,
+        //resolves true if all the remotes are closed before the deadline
+        cmt::Future<bool> drain();
+        bool drainOnStop() const;
+        std::chrono::seconds drainDeadline() const;
+
     public:
         void localAddressDeclare(const transport::Address& a);
         void localAddressUndeclare(const transport::Address& a);
@@ -38,21 +51,84 @@ namespace dci::module::ppn
         transport::Address fixAcceptorAddress(const transport::Address& a);
         transport::Address fixConnectorAddress(const transport::Address& a);
 
-        transport::acceptor::Downstream<> makeAcceptor(const transport::Address& a);
-        transport::connector::Downstream<> makeConnector(const transport::Address& a);
+        transport::acceptor::Downstream<> makeAcceptor(const transport::Address& a, const config::ptree& options);
+        transport::connector::Downstream<> makeConnector(const transport::Address& a, const config::ptree& options);
 
     private:
+        //inbound volume of a channel, counted from its received signal on the session data path
+        struct Traffic
+        {
+            uint64                                  _bytes {};
+            uint64                                  _chunks {};     //received signals, transport reads, not protocol messages
+            std::chrono::steady_clock::time_point   _last;
+        };
+
+        std::shared_ptr<Traffic> trafficWatch(transport::Channel<>& ch);
+
+        //handshakes are driven by future continuations, a dialing entry fiber ends once the dial is issued
+        struct CSessionState
+        {
+            Node *                                  _node {};
+            api::link::Id                           _id;
+            transport::Address                      _address;
+            api::feature::CSession<>::Opposite      _s {idl::interface::Initializer{}};
+            sbs::Owner                              _sbsOwner4Id;
+            std::chrono::steady_clock::time_point   _begin;
+            bool                                    _connecting = true;
+            std::shared_ptr<Traffic>                _traffic;
+
+            CSessionState(Node* node, const api::link::Id& id, const transport::Address& a);
+            ~CSessionState();
+
+            void fail(ExceptionPtr e);
+        };
+
+        struct ASessionState
+        {
+            Node *                                  _node {};
+            api::feature::ASession<>::Opposite      _s {idl::interface::Initializer{}};
+            cmt::Future<transport::Address>         _remoteAddress;
+            sbs::Owner                              _sbsOwner4Id;
+            std::chrono::steady_clock::time_point   _begin;
+            bool                                    _worker = true;     //holds an accept worker slot
+            std::shared_ptr<Traffic>                _traffic;
+
+            ASessionState(Node* node, cmt::Future<transport::Address>&& remoteAddress);
+            ~ASessionState();
+
+            void fail(ExceptionPtr e);
+            void release();     //gives the worker slot to the next pending channel
+        };
+
+        //unfinished sessions, failed explicitly on stop
+        std::unordered_set<CSessionState*>  _csessions;
+        std::unordered_set<ASessionState*>  _asessions;
+        void sessionsCancel();
+
         void csessionWorker(api::link::Id id, const transport::Address& a);
+        void csessionConnect(std::shared_ptr<CSessionState> cs);
+        void csessionJoin(std::shared_ptr<CSessionState> cs, transport::Channel<>&& ch);
         void asessionWorker(transport::Channel<>&& ch);
+        void asessionAdmit(transport::Channel<>&& ch);
+        void asessionScreen(transport::Channel<>&& ch, transport::Address&& remote);
+        void asessionPass(transport::Channel<>&& ch, const transport::Address& remote);
+        void asessionQueue(transport::Channel<>&& ch);
+        void asessionNext();
+
+        template <class SessionOpposite>
+        void remoteJoined(const api::link::Id& id, const api::link::Remote<>& r, SessionOpposite&& s, const transport::Address& a, bool byConnect, std::chrono::steady_clock::time_point begin, std::shared_ptr<Traffic> traffic);
 
         void flushJoinWaiters(const transport::Address& a, ExceptionPtr e);
         void flushJoinWaiters(const transport::Address& a, api::link::Remote<> r);
+        List<cmt::Promise<api::link::Remote<>>> extractJoinWaiters(const transport::Address& a);
 
     private:
         cmt::task::Owner _tow;
 
         bool _started = false;
 
+        node::State _state;
+
         List<idl::Interface>                _features;
         api::feature::Service<>::Opposite   _featureService;
 
@@ -65,9 +141,30 @@ namespace dci::module::ppn
         std::unique_ptr<node::NetEnumerator> _netEnumerator;
         node::TransportHub<transport::Acceptor<>, transport::acceptor::Downstream<>> _acceptors;
         node::TransportHub<transport::Connector<>, transport::connector::Downstream<>> _connectors;
+        bool _connectMatchScope = false;
+        node::Sim _sim;
 
         Set<transport::Address> _declaredLocalAddresses;
 
+        node::DeclaredJournal _declaredJournal;
+
+        //self-probe of declared addresses through own connectors
+        bool                                                    _probe = false;
+        Map<transport::Address, api::feature::AddressReachability> _reachability;
+        std::unique_ptr<poll::Timer>                            _probeTimer;
+        node::utils::AddressSet                                 _probing;       //declared addresses with a probe in flight
+        node::utils::AddressSet                                 _probeSources;  //local ends of probe channels, seen as remote by own acceptors
+        List<std::pair<transport::Channel<>, transport::Address>> _probeHeld;   //inbound from own hosts arrived while probes are in flight
+        static constexpr std::size_t                            _probeHeldMax = 64;
+        std::unique_ptr<poll::Timer>                            _probeHeldTimer; //releases the held ones at the hold deadline
+
+        void probe(const transport::Address& a);
+        void probeDone(const transport::Address& a, std::chrono::steady_clock::time_point start, bool reachable);
+        bool probeCandidate(const transport::Address& remote) const;
+        void probeSettled();
+        void probeRelease();
+        void probeAll();
+
         transport::Natt<> _natt;
 
         struct Mapping
@@ -75,18 +172,171 @@ namespace dci::module::ppn
             Node *                      _node {};
             transport::natt::Mapping<>  _api;
             sbs::Owner                  _sbsOwner;
+            String                      _group;
+            transport::Address          _internal;
             transport::Address          _external;
 
-            Mapping(Node* node, transport::natt::Mapping<>&& api, const transport::Address& internal);
+            bool                                    _established = false;
+            std::chrono::system_clock::time_point   _created;
+
+            std::chrono::steady_clock::time_point   _requested;
+            std::chrono::milliseconds               _requestLatency {};
+            std::chrono::milliseconds               _establishLatency {};
+
+            Mapping(
+                    Node* node,
+                    const String& group,
+                    transport::natt::Mapping<>&& api,
+                    const transport::Address& internal,
+                    std::chrono::steady_clock::time_point requested);
             ~Mapping();
         };
 
-        std::map<transport::Address, Mapping> _nattMappings;
+        //by protocol, family, reach and internal port
+        std::map<String, Mapping>                   _nattMappings;
+        Map<String, uint64>                         _nattPending;   //group -> request serial, a detach cancels by erasing
+        uint64                                      _nattSerial {};
+        Map<String, node::utils::AddressSet>        _nattMembers;   //internal addresses acceptors started on
+
+        bool                                _nattPersist = true;
+        std::chrono::seconds                _nattBindGrace {60};
+        poll::Timer                         _nattTimer {std::chrono::seconds{10}, true, [this]{nattTick();}};
+
+        static String nattGroup(const transport::Address& internal);
+        void nattAttach(const transport::Address& internal);
+        void nattDetach(const transport::Address& internal);
+        void nattRequest(const String& group, const transport::Address& internal);
+        void nattRestore();
+        void nattPersist(const Mapping& m);
+        void nattForget(const Mapping& m);
+        void nattTick();
 
     private:
-        Set<transport::Address>                                                 _connectionsInProgress;
-        std::multimap<transport::Address, cmt::Promise<api::link::Remote<>>>    _joinWaiters;
+        node::utils::AddressSet                                             _connectionsInProgress;
+        node::utils::AddressMultiMap<cmt::Promise<api::link::Remote<>>>     _joinWaiters;
+
+        //inbound handshake admission, 0 workers means unlimited
+        uint32                          _acceptWorkers = 0;
+        uint32                          _acceptPendingMax = 1024;
+        uint32                          _acceptWorkersActive = 0;      //handshakes in flight
+        std::deque<transport::Channel<>> _acceptPending;
+        bool                            _acceptDraining = false;
+        node::SourceLimiter             _sourceLimiter;
+
+        //session accounting
+        uint32  _sessionsConnecting = 0;
+        uint32  _sessionsAccepting = 0;
+        uint32  _sessionsJoined = 0;
+
+        uint64  _connectsStarted = 0;
+        uint64  _acceptsStarted = 0;
+        uint64  _connectFailed = 0;
+        uint64  _connectHandshakeFailed = 0;
+        uint64  _acceptHandshakeFailed = 0;
+        uint64  _acceptDropped = 0;
+        uint64  _acceptRateLimited = 0;
+        uint64  _acceptBlocked = 0;
+
+        //dials per second over a sliding window of full seconds, ring indexed by the second
+        static constexpr size_t         _connectsWindow = 10;
+        std::array<uint32, _connectsWindow+1> _connectsRate {};
+        int64                           _connectsRateSecond = 0;
+
+        //join durations, microseconds: up to 1ms, 10ms, 100ms, 1s, 10s and above
+        std::array<uint64, 6>   _joinBuckets {};
+        uint64                  _joinSum = 0;
+
+        void connectsRateTick(uint32 add);
+        api::SessionStats sessionStats() const;
+        api::Stats stats();
+
+        //joined remotes, the kept one of a duplicate pair replaces the entry, serial tells whose closed it is
+        struct RemoteEntry
+        {
+            uint64                                  _serial {};
+            api::link::Remote<>                     _remote;
+            bool                                    _byConnect {};
+            String                                  _scheme;
+            uint64                                  _handshake {};     //handshake time, microseconds from dial or accept to join, not an rtt
+            std::chrono::steady_clock::time_point   _joined;
+            std::chrono::steady_clock::time_point   _active;    //last demand from features
+            std::shared_ptr<Traffic>                _traffic;
+            bool                                    _closing {};    //closed by the node (evict, idle, drain, duplicate), close still on the way
+        };
+
+        uint64                          _remotesSerial = 0;
+        Map<api::link::Id, RemoteEntry> _remotes;
+
+        List<api::RemoteInfo> remotes(uint32 limit) const;
+
+        //cap of remotes, joined and in handshake, 0 - unlimited, with slots reserved for each direction,
+        //checked before a handshake starts
+        enum class RemotesEvict
+        {
+            none,       //refuse the newcomer
+            lru,        //the least recently active: demand from features or received data
+            oldest,     //the longest joined
+            slowest,    //the longest handshake, a far or overloaded peer
+        };
+
+        uint32          _remotesMax = 0;
+        uint32          _remotesInboundReserve = 0;
+        uint32          _remotesOutboundReserve = 0;
+        RemotesEvict    _remotesEvict = RemotesEvict::lru;
+        uint32          _remotesInbound = 0;    //joined, evicting ones are not counted
+        uint32          _remotesOutbound = 0;
+        uint64          _remotesEvicted = 0;
+        uint64          _remotesRefused = 0;
+        std::unordered_set<uint64> _remotesEvicting;    //serials closed by eviction, their close is still on the way
+
+        bool remotesCapAdmit(bool byConnect);
+        bool remotesEvict(bool byConnect);
+        static std::chrono::steady_clock::time_point lastActive(const RemoteEntry& e);
+
+        //idle reaper, one timer over a wheel of slots with remotes to recheck, 0 timeout - off
+        node::IdleWheel                 _idleWheel;
+        std::unique_ptr<poll::Timer>    _idleTimer;
+        uint64                          _remotesIdleClosed = 0;
+
+        void idleTick();
+
+        //one remote per id, duplicates of simultaneous open are resolved the same way on both sides
+        api::link::Id   _ownId {};
+        uint64          _remotesDuplicate = 0;
+
+        bool remoteDuplicateResolve(const api::link::Id& id, bool byConnect);
+
+        void remoteTouch(const api::link::Id& id);
+
+        //graceful leave
+        bool                            _drainOnStop = false;
+        std::chrono::seconds            _drainDeadline {30};
+        uint32                          _drainBatch = 64;
+        std::chrono::milliseconds       _drainPace {200};
+        bool                            _draining = false;
+        bool                            _drained = false;
+        std::chrono::steady_clock::time_point _drainBegin;
+        std::unique_ptr<poll::Timer>    _drainTimer;            //paces the batches
+        std::unique_ptr<poll::Timer>    _drainDeadlineTimer;    //ends the drain on time whatever the pace is
+        List<cmt::Promise<bool>>        _drainWaiters;
+
+        void drainTick();
+        void drainDone();
+
+        //acceptors kept bound for the next node started in this process
+        bool                            _handoff = false;
+        std::chrono::seconds            _handoffTtl {30};
+        bool                            _handedOff = false;
+        List<transport::Channel<>>      _handoffAccepted;
+
+        void handoffAcceptors();
+        void handoffAdmit();
+
+        //prometheus text, rendered on the timer and served aside
+        std::unique_ptr<node::Exporter> _exporter;
+        std::unique_ptr<poll::Timer>    _exporterTimer;
 
+        void exportMetrics();
 
     private:
         Map<idl::ILid, api::feature::AgentProvider<>> _agentRegistry;
@@ -33,11 +33,47 @@ namespace dci::module::ppn::node
     {
         if(_node)
         {
+            if(_node->drainOnStop())
+            {
+                drain();
+            }
+
             _node->stop();
             _node.reset();
         }
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Daemon::drain()
+    {
+        //stop comes by the idl call and is served on the fiber of the caller, the wait below
+        //suspends that fiber only; it ends by the node or by an own guard a bit past the deadline
+        bool done = false;
+        cmt::Promise<void> finished;
+        auto finish = [&]
+        {
+            if(!done)
+            {
+                done = true;
+                finished.resolveValue();
+            }
+        };
+
+        sbs::Owner sbsOwner;
+        _node->drain().then() += sbsOwner * [&](cmt::Future<bool>)
+        {
+            finish();
+        };
+
+        poll::Timer guard{_node->drainDeadline() + std::chrono::seconds{1}, false, finish};
+        guard.start();
+
+        finished.future().value();
+
+        guard.stop();
+        sbsOwner.flush();
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     idl::Interface Daemon::serviceImpl()
     {
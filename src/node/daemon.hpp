@@ -26,6 +26,8 @@ namespace dci::module::ppn::node
         idl::Interface serviceImpl();
 
     private:
+        void drain();
+
         std::unique_ptr<Node>       _node;
     };
 }
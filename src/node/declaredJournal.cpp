@@ -0,0 +1,84 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#include "pch.hpp"
+#include "declaredJournal.hpp"
+
+namespace dci::module::ppn::node
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    DeclaredJournal::DeclaredJournal(size_t limit)
+        : _limit{std::max(size_t{1}, limit)}
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    DeclaredJournal::~DeclaredJournal()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    uint64 DeclaredJournal::version() const
+    {
+        return _version;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void DeclaredJournal::changed(const transport::Address& a)
+    {
+        _version++;
+
+        _changes.push_back(Change{_version, a});
+        if(_changes.size() > _limit)
+        {
+            _changes.pop_front();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    api::feature::DeclaredDelta DeclaredJournal::since(uint64 version, const Set<transport::Address>& declared) const
+    {
+        api::feature::DeclaredDelta res;
+        res.version = _version;
+        res.full = false;
+
+        if(version == _version)
+        {
+            return res;
+        }
+
+        if(version > _version || _changes.empty() || version+1 < _changes.front()._version)
+        {
+            //unknown or too old version, the whole set
+            res.full = true;
+            res.added = declared;
+            return res;
+        }
+
+        //journal is ordered by version, walk back from the newest to the requested
+        Set<transport::Address> touched;
+        for(auto iter{_changes.rbegin()}; iter != _changes.rend() && iter->_version > version; ++iter)
+        {
+            touched.insert(iter->_address);
+        }
+
+        for(const transport::Address& a : touched)
+        {
+            if(declared.contains(a))
+            {
+                res.added.insert(a);
+            }
+            else
+            {
+                res.removed.insert(a);
+            }
+        }
+
+        return res;
+    }
+}
@@ -0,0 +1,40 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#pragma once
+
+#include "pch.hpp"
+
+namespace dci::module::ppn::node
+{
+    //versioned changes of the declared set, bounded; a consumer asks for the delta from the version it knows
+    class DeclaredJournal
+    {
+    public:
+        DeclaredJournal(size_t limit = 1024);
+        ~DeclaredJournal();
+
+        uint64 version() const;
+        void changed(const transport::Address& a);
+
+        //addresses touched after the version, sorted by the current declared set, the whole set
+        //if the version is unknown or older than the journal keeps
+        api::feature::DeclaredDelta since(uint64 version, const Set<transport::Address>& declared) const;
+
+    private:
+        struct Change
+        {
+            uint64              _version {};
+            transport::Address  _address;
+        };
+
+        uint64              _version = 0;
+        std::deque<Change>  _changes;
+        size_t              _limit;
+    };
+}
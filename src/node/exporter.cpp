@@ -0,0 +1,279 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#include "pch.hpp"
+#include "exporter.hpp"
+#include "utils.hpp"
+
+#ifndef _WIN32
+#   include <sys/socket.h>
+#   include <sys/un.h>
+#   include <netinet/in.h>
+#   include <arpa/inet.h>
+#   include <unistd.h>
+#   include <fcntl.h>
+#   include <poll.h>
+#endif
+
+namespace dci::module::ppn::node
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Exporter::Exporter()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Exporter::~Exporter()
+    {
+        stop();
+    }
+
+#ifdef _WIN32
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Exporter::start(const String& listen)
+    {
+        throw api::Error("metrics exporter is not supported on this platform: "+listen);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Exporter::stop()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Exporter::serve()
+    {
+    }
+#else
+    namespace
+    {
+        int listenLocal(const String& path)
+        {
+            sockaddr_un sa{};
+            if(path.size() >= sizeof(sa.sun_path))
+            {
+                throw api::Error("metrics exporter path is too long: "+path);
+            }
+            sa.sun_family = AF_UNIX;
+            std::memcpy(sa.sun_path, path.data(), path.size());
+
+            ::unlink(path.c_str());
+
+            int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if(0 > fd || ::bind(fd, reinterpret_cast<const sockaddr*>(&sa), sizeof(sa)))
+            {
+                if(0 <= fd) ::close(fd);
+                throw api::Error("metrics exporter unable to bind "+path+": "+std::strerror(errno));
+            }
+
+            return fd;
+        }
+
+        int listenTcp4(const String& hostPort)
+        {
+            size_t colon = hostPort.rfind(':');
+            if(hostPort.npos == colon)
+            {
+                throw api::Error("metrics exporter port is absent: "+hostPort);
+            }
+
+            sockaddr_in sa{};
+            sa.sin_family = AF_INET;
+            sa.sin_port = htons(static_cast<uint16>(utils::parseUint32(hostPort.substr(colon+1))));
+            if(1 != ::inet_pton(AF_INET, hostPort.substr(0, colon).c_str(), &sa.sin_addr))
+            {
+                throw api::Error("metrics exporter host is malformed: "+hostPort);
+            }
+
+            if(127 != ntohl(sa.sin_addr.s_addr) >> 24)
+            {
+                LOGW("metrics exporter listens on non-loopback address: "<<hostPort);
+            }
+
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            int one = 1;
+            if(0 > fd ||
+               ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) ||
+               ::bind(fd, reinterpret_cast<const sockaddr*>(&sa), sizeof(sa)))
+            {
+                if(0 <= fd) ::close(fd);
+                throw api::Error("metrics exporter unable to bind "+hostPort+": "+std::strerror(errno));
+            }
+
+            return fd;
+        }
+
+        void writeAll(int fd, const char* data, size_t size)
+        {
+            while(size)
+            {
+                ssize_t res = ::send(fd, data, size, MSG_NOSIGNAL);
+                if(0 >= res)
+                {
+                    return;
+                }
+                data += res;
+                size -= static_cast<size_t>(res);
+            }
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Exporter::start(const String& listen)
+    {
+        stop();
+
+        if(listen.starts_with("local://"))
+        {
+            _path = listen.substr(8);
+            _fd = listenLocal(_path);
+        }
+        else if(listen.starts_with("tcp4://"))
+        {
+            _fd = listenTcp4(listen.substr(7));
+        }
+        else
+        {
+            throw api::Error("metrics exporter address is not supported: "+listen);
+        }
+
+        if(::listen(_fd, 16) || ::pipe2(_wake, O_CLOEXEC))
+        {
+            int err = errno;
+            stop();
+            throw api::Error("metrics exporter unable to listen "+listen+": "+std::strerror(err));
+        }
+
+        _thread = std::thread{[this]{serve();}};
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Exporter::stop()
+    {
+        if(_thread.joinable())
+        {
+            char c{};
+            [[maybe_unused]] ssize_t res = ::write(_wake[1], &c, 1);
+            _thread.join();
+        }
+
+        auto close = [](int& fd)
+        {
+            if(0 <= fd)
+            {
+                ::close(fd);
+                fd = -1;
+            }
+        };
+        close(_fd);
+        close(_wake[0]);
+        close(_wake[1]);
+
+        if(!_path.empty())
+        {
+            ::unlink(_path.c_str());
+            _path.clear();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Exporter::serve()
+    {
+        for(;;)
+        {
+            pollfd fds[2] {{_fd, POLLIN, 0}, {_wake[0], POLLIN, 0}};
+            if(0 > ::poll(fds, 2, -1))
+            {
+                if(EINTR == errno) continue;
+                return;
+            }
+
+            if(fds[1].revents)
+            {
+                return;
+            }
+
+            int client = ::accept4(_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if(0 > client)
+            {
+                continue;
+            }
+
+            //the request itself is of no interest, any path gets the metrics
+            timeval tv{1, 0};
+            ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+            String request;
+            char buf[1024];
+            while(request.size() < 8192 && request.npos == request.find("\r\n\r\n"))
+            {
+                ssize_t res = ::recv(client, buf, sizeof(buf), 0);
+                if(0 >= res) break;
+                request.append(buf, static_cast<size_t>(res));
+            }
+
+            String text;
+            {
+                std::lock_guard lock{_mtx};
+                text = _text;
+            }
+
+            String head =
+                    "HTTP/1.0 200 OK\r\n"
+                    "Content-Type: text/plain; version=0.0.4\r\n"
+                    "Content-Length: " + std::to_string(text.size()) + "\r\n"
+                    "Connection: close\r\n"
+                    "\r\n";
+
+            writeAll(client, head.data(), head.size());
+            writeAll(client, text.data(), text.size());
+            ::close(client);
+        }
+    }
+#endif
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Exporter::publish(String&& text)
+    {
+        std::lock_guard lock{_mtx};
+        _text = std::move(text);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Exporter::counter(std::ostream& out, const char* name, const char* help, uint64 value)
+    {
+        out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << " counter\n" << name << ' ' << value << '\n';
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Exporter::gauge(std::ostream& out, const char* name, const char* help, uint64 value)
+    {
+        out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << " gauge\n" << name << ' ' << value << '\n';
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Exporter::histogram(std::ostream& out, const char* name, const char* help, const uint64* bounds, const uint64* buckets, size_t amount, uint64 sum)
+    {
+        out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << " histogram\n";
+
+        //buckets are per interval, prometheus wants them cumulative, the last one is +Inf
+        uint64 cumulative{};
+        for(size_t i{}; i<amount; ++i)
+        {
+            cumulative += buckets[i];
+            out << name << "_bucket{le=\"";
+            if(i+1 < amount) out << bounds[i];
+            else out << "+Inf";
+            out << "\"} " << cumulative << '\n';
+        }
+
+        out << name << "_sum " << sum << '\n';
+        out << name << "_count " << cumulative << '\n';
+    }
+}
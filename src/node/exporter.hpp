@@ -0,0 +1,48 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#pragma once
+
+#include "pch.hpp"
+#include <thread>
+#include <mutex>
+
+namespace dci::module::ppn::node
+{
+    //prometheus text over http on a local socket or loopback port, served by an own thread
+    //from the text published last, so a scrape never touches the node
+    class Exporter
+    {
+    public:
+        Exporter();
+        ~Exporter();
+
+        //local:///path or tcp4://127.0.0.1:port
+        void start(const String& listen);
+        void stop();
+
+        void publish(String&& text);
+
+    public:
+        static void counter(std::ostream& out, const char* name, const char* help, uint64 value);
+        static void gauge(std::ostream& out, const char* name, const char* help, uint64 value);
+        static void histogram(std::ostream& out, const char* name, const char* help, const uint64* bounds, const uint64* buckets, size_t amount, uint64 sum);
+
+    private:
+        void serve();
+
+    private:
+        String              _path;
+        int                 _fd = -1;
+        int                 _wake[2] {-1, -1};
+        std::thread         _thread;
+
+        std::mutex          _mtx;
+        String              _text;
+    };
+}
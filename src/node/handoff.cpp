@@ -0,0 +1,106 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#include "pch.hpp"
+#include "handoff.hpp"
+
+namespace dci::module::ppn::node
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Handoff& Handoff::instance()
+    {
+        static Handoff instance;
+        return instance;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Handoff::park(const transport::Address& a, transport::acceptor::Downstream<>&& lo, std::chrono::seconds ttl)
+    {
+        expire();
+
+        if(!lo)
+        {
+            return;
+        }
+
+        //the timer runs while anything is parked
+        bool first = _parked.empty();
+
+        Parked& p = _parked[a];
+        p._sol.flush();
+        p._accepted.clear();
+        p._lo = std::move(lo);
+        p._expiry = std::chrono::steady_clock::now() + ttl;
+
+        //the acceptor keeps accepting, nobody else listens to it until adopted
+        p._lo->accepted() += p._sol * [&p](transport::Channel<>&& ch)
+        {
+            if(p._accepted.size() < _acceptedMax)
+            {
+                p._accepted.emplace_back(std::move(ch));
+            }
+        };
+
+        if(!_expireTimer)
+        {
+            _expireTimer.reset(new poll::Timer{std::chrono::seconds{1}, true, [this]{expire();}});
+        }
+
+        if(first)
+        {
+            _expireTimer->start();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    transport::acceptor::Downstream<> Handoff::adopt(const transport::Address& a, List<transport::Channel<>>& accepted)
+    {
+        expire();
+
+        auto iter = _parked.find(a);
+        if(_parked.end() == iter)
+        {
+            return {};
+        }
+
+        iter->second._sol.flush();
+        for(transport::Channel<>& ch : iter->second._accepted)
+        {
+            accepted.emplace_back(std::move(ch));
+        }
+        transport::acceptor::Downstream<> res = std::move(iter->second._lo);
+        _parked.erase(iter);
+
+        expire();
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Handoff::expire()
+    {
+        //nobody came for them in time, closed by release together with what they accepted
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::erase_if(_parked, [&](const auto& p)
+        {
+            return p.second._expiry <= now;
+        });
+
+        //may be inside the timer's own callback, so stopped only
+        if(_parked.empty() && _expireTimer)
+        {
+            _expireTimer->stop();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Handoff::release()
+    {
+        _parked.clear();
+        _expireTimer.reset();
+    }
+}
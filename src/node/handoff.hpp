@@ -0,0 +1,46 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#pragma once
+
+#include "pch.hpp"
+#include "utils.hpp"
+
+namespace dci::module::ppn::node
+{
+    //bound acceptors parked by a stopping node for the next one started in the same process,
+    //connections they accept in between are kept for the successor, up to a bound
+    class Handoff
+    {
+    public:
+        static Handoff& instance();
+
+        void park(const transport::Address& a, transport::acceptor::Downstream<>&& lo, std::chrono::seconds ttl);
+        transport::acceptor::Downstream<> adopt(const transport::Address& a, List<transport::Channel<>>& accepted);
+
+        //everything parked is closed, at module stop while the runtime is still there
+        void release();
+
+    private:
+        void expire();
+
+    private:
+        struct Parked
+        {
+            transport::acceptor::Downstream<>       _lo;
+            std::chrono::steady_clock::time_point   _expiry;
+            List<transport::Channel<>>              _accepted;
+            sbs::Owner                              _sol;
+        };
+
+        static constexpr std::size_t _acceptedMax = 256;
+
+        utils::AddressMap<Parked>       _parked;
+        std::unique_ptr<poll::Timer>    _expireTimer;   //stopped when nothing is parked, freed by release
+    };
+}
@@ -0,0 +1,90 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#include "pch.hpp"
+#include "idleWheel.hpp"
+
+namespace dci::module::ppn::node
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    IdleWheel::IdleWheel()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    IdleWheel::~IdleWheel()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void IdleWheel::configure(std::chrono::seconds timeout)
+    {
+        _timeout = timeout;
+        _slots.clear();
+        _cursor = 0;
+
+        if(!_timeout.count())
+        {
+            return;
+        }
+
+        _tick = std::max(std::chrono::seconds{1}, _timeout / 32);
+        _slots.resize(static_cast<size_t>((_timeout + _tick - std::chrono::seconds{1}) / _tick) + 1);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void IdleWheel::clear()
+    {
+        for(std::vector<Entry>& slot : _slots)
+        {
+            slot.clear();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::chrono::seconds IdleWheel::timeout() const
+    {
+        return _timeout;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::chrono::seconds IdleWheel::tick() const
+    {
+        return _tick;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void IdleWheel::schedule(const api::link::Id& id, uint64 serial, std::chrono::steady_clock::time_point due, std::chrono::steady_clock::time_point now)
+    {
+        if(_slots.empty())
+        {
+            return;
+        }
+
+        std::chrono::steady_clock::duration delta = due - now;
+
+        size_t ticks = static_cast<size_t>(std::max(std::chrono::steady_clock::duration{}, delta + _tick - std::chrono::steady_clock::duration{1}) / _tick);
+        ticks = std::clamp(ticks, size_t{1}, _slots.size()-1);
+
+        _slots[(_cursor + ticks) % _slots.size()].emplace_back(id, serial);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::vector<IdleWheel::Entry> IdleWheel::advance()
+    {
+        std::vector<Entry> res;
+        if(_slots.empty())
+        {
+            return res;
+        }
+
+        _cursor = (_cursor + 1) % _slots.size();
+        res.swap(_slots[_cursor]);
+        return res;
+    }
+}
@@ -0,0 +1,43 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#pragma once
+
+#include "pch.hpp"
+
+namespace dci::module::ppn::node
+{
+    //timing wheel of remotes to recheck for idleness, about 32 ticks per timeout; the owner
+    //advances it once per tick and rechecks what comes out
+    class IdleWheel
+    {
+    public:
+        using Entry = std::pair<api::link::Id, uint64>;
+
+    public:
+        IdleWheel();
+        ~IdleWheel();
+
+        //0 timeout - off, anything scheduled before is dropped
+        void configure(std::chrono::seconds timeout);
+        void clear();
+
+        std::chrono::seconds timeout() const;
+        std::chrono::seconds tick() const;
+
+        //comes out within one tick after due, not earlier than the next tick, not later than a timeout
+        void schedule(const api::link::Id& id, uint64 serial, std::chrono::steady_clock::time_point due, std::chrono::steady_clock::time_point now);
+        std::vector<Entry> advance();
+
+    private:
+        std::chrono::seconds                _timeout {};
+        std::chrono::seconds                _tick {1};
+        std::vector<std::vector<Entry>>     _slots;
+        size_t                              _cursor = 0;
+    };
+}
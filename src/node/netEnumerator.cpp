@@ -140,6 +140,18 @@ namespace dci::module::ppn::node
         updateResult();
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    size_t NetEnumerator::linksAmount() const
+    {
+        return _linkAddresses.size();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    size_t NetEnumerator::addressesAmount() const
+    {
+        return _result.size();
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     void NetEnumerator::updateResult()
     {
@@ -37,6 +37,9 @@ namespace dci::module::ppn::node
         sbs::Signal<void, Address> add();
         sbs::Signal<void, Address> del();
 
+        size_t linksAmount() const;
+        size_t addressesAmount() const;
+
     private:
         sbs::Wire<void, ExceptionPtr> _failed;
         sbs::Wire<void, Address> _add;
@@ -0,0 +1,134 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#include "pch.hpp"
+#include "sim.hpp"
+#include "utils.hpp"
+
+namespace dci::module::ppn::node
+{
+    namespace
+    {
+        constexpr char simPrefix[] = "sim://";
+        constexpr char carrierPrefix[] = "inproc://sim.";
+
+        double parseProbability(const String& param)
+        {
+            double res = std::stod(param);
+            if(res < 0 || res > 1)
+            {
+                throw api::Error("bad probability value: "+param);
+            }
+            return res;
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Sim::Sim()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Sim::~Sim()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Sim::configure(const config::ptree& conf)
+    {
+        _latency = std::chrono::milliseconds{utils::parseUint32(conf.get("latency", "0"))};
+        _jitter = std::chrono::milliseconds{utils::parseUint32(conf.get("jitter", "0"))};
+        _fail = parseProbability(conf.get("fail", "0"));
+        _hang = parseProbability(conf.get("hang", "0"));
+        _hangFor = std::chrono::milliseconds{utils::parseUint32(conf.get("hangFor", "30000"))};
+
+        //same seed - same sequence of faults
+        _rnd.seed(utils::parseUint32(conf.get("seed", "0")));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Sim::is(const transport::Address& a)
+    {
+        return a.value.starts_with(simPrefix);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    transport::Address Sim::toCarrier(const transport::Address& a)
+    {
+        if(!is(a))
+        {
+            return a;
+        }
+
+        return transport::Address{carrierPrefix + a.value.substr(sizeof(simPrefix)-1)};
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    transport::Address Sim::fromCarrier(const transport::Address& a)
+    {
+        if(!a.value.starts_with(carrierPrefix))
+        {
+            return a;
+        }
+
+        return transport::Address{simPrefix + a.value.substr(sizeof(carrierPrefix)-1)};
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Sim::Outcome Sim::dial(const transport::Address& a)
+    {
+        std::uniform_real_distribution<double> probability{0, 1};
+
+        //drawn in fixed order regardless of the outcome, keeps the sequence reproducible
+        std::chrono::milliseconds delay = _latency;
+        if(_jitter.count())
+        {
+            delay += std::chrono::milliseconds{std::uniform_int_distribution<int64>{0, _jitter.count()}(_rnd)};
+        }
+        bool fail = probability(_rnd) < _fail;
+        bool hang = probability(_rnd) < _hang;
+
+        if(hang)
+        {
+            return Outcome::hang;
+        }
+
+        sleep(delay);
+
+        if(fail)
+        {
+            throw api::Error("sim: connection refused: "+a.value);
+        }
+
+        return Outcome::connect;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Sim::hang()
+    {
+        sleep(_hangFor);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Sim::sleep(std::chrono::milliseconds duration)
+    {
+        if(!duration.count())
+        {
+            return;
+        }
+
+        cmt::Promise<void> elapsed;
+        poll::Timer timer{duration, false, [&]
+        {
+            elapsed.resolveValue();
+        }};
+
+        timer.start();
+        elapsed.future().value();
+    }
+}
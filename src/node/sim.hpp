@@ -0,0 +1,53 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#pragma once
+
+#include "pch.hpp"
+
+namespace dci::module::ppn::node
+{
+    //sim://name addresses, carried by inproc with faults injected on the dial side only,
+    //the accept side sees just their effects: late, absent or silent channels
+    class Sim
+    {
+    public:
+        Sim();
+        ~Sim();
+
+        void configure(const config::ptree& conf);
+
+        static bool is(const transport::Address& a);
+        static transport::Address toCarrier(const transport::Address& a);
+        static transport::Address fromCarrier(const transport::Address& a);
+
+        enum class Outcome
+        {
+            connect,
+            hang,   //connect, then keep the channel silent for hangFor and fail
+        };
+
+        //sleeps for injected latency, throws on injected failure
+        Outcome dial(const transport::Address& a);
+
+        //sleeps for hangFor
+        void hang();
+
+    private:
+        void sleep(std::chrono::milliseconds duration);
+
+    private:
+        std::chrono::milliseconds   _latency {};
+        std::chrono::milliseconds   _jitter {};
+        double                      _fail {};
+        double                      _hang {};
+        std::chrono::milliseconds   _hangFor {30000};
+
+        std::mt19937_64             _rnd;
+    };
+}
@@ -0,0 +1,137 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#include "pch.hpp"
+#include "sourceLimiter.hpp"
+#include "utils.hpp"
+
+namespace dci::module::ppn::node
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    SourceLimiter::SourceLimiter()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    SourceLimiter::~SourceLimiter()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void SourceLimiter::configure(const config::ptree& conf)
+    {
+        _rate = utils::parseUint32(conf.get("rate", "0"));
+        _burst = std::max(uint32{1}, utils::parseUint32(conf.get("burst", "16")));
+        _bucketsLimit = std::max(uint32{1}, utils::parseUint32(conf.get("sources", "65536")));
+
+        _blocked.clear();
+        auto range = conf.equal_range("block");
+        for(auto iter{range.first}; iter != range.second; ++iter)
+        {
+            transport::Address a{iter->second.data()};
+            String prefix = utils::addressPrefix(a);
+            if(prefix.empty())
+            {
+                throw api::Error("bad blocked address in config, tcp4 or tcp6 expected: "+a.value);
+            }
+            _blocked.insert(std::move(prefix));
+        }
+
+        _buckets.clear();
+        _lru.clear();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool SourceLimiter::active() const
+    {
+        return _rate || !_blocked.empty();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    SourceLimiter::Verdict SourceLimiter::admit(const transport::Address& a)
+    {
+        return admit(a, std::chrono::steady_clock::now());
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    SourceLimiter::Verdict SourceLimiter::admit(const transport::Address& a, std::chrono::steady_clock::time_point now)
+    {
+        String prefix = utils::addressPrefix(a);
+        if(prefix.empty())
+        {
+            //inproc, local - not a network source
+            return Verdict::pass;
+        }
+
+        if(_blocked.contains(prefix))
+        {
+            return Verdict::blocked;
+        }
+
+        if(!_rate)
+        {
+            return Verdict::pass;
+        }
+
+        purge(now);
+
+        auto iter = _buckets.find(prefix);
+        if(_buckets.end() == iter)
+        {
+            if(_buckets.size() >= _bucketsLimit)
+            {
+                _buckets.erase(_lru.front());
+                _lru.pop_front();
+            }
+
+            _lru.push_back(prefix);
+            iter = _buckets.emplace(std::move(prefix), Bucket{static_cast<double>(_burst), now, std::prev(_lru.end())}).first;
+        }
+        else
+        {
+            _lru.splice(_lru.end(), _lru, iter->second._lru);
+        }
+
+        Bucket& b = iter->second;
+        b._tokens = std::min(static_cast<double>(_burst), b._tokens + std::chrono::duration<double>(now - b._last).count() * _rate);
+        b._last = now;
+
+        if(b._tokens < 1)
+        {
+            return Verdict::limited;
+        }
+
+        b._tokens -= 1;
+        return Verdict::pass;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    size_t SourceLimiter::tracked() const
+    {
+        return _buckets.size();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void SourceLimiter::purge(std::chrono::steady_clock::time_point now)
+    {
+        //refilled buckets carry no state, a fresh one is the same; a few of the oldest per call
+        std::chrono::duration<double> refill{static_cast<double>(_burst) / _rate};
+
+        for(size_t step{}; step < _purgeStep && !_lru.empty(); ++step)
+        {
+            auto iter = _buckets.find(_lru.front());
+            if(now - iter->second._last < refill)
+            {
+                break;
+            }
+
+            _buckets.erase(iter);
+            _lru.pop_front();
+        }
+    }
+}
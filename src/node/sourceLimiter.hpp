@@ -0,0 +1,64 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#pragma once
+
+#include "pch.hpp"
+
+namespace dci::module::ppn::node
+{
+    //inbound handshakes by source, /24 for ip4 and /56 for ip6: token bucket per prefix and a blocklist
+    class SourceLimiter
+    {
+    public:
+        enum class Verdict
+        {
+            pass,
+            limited,
+            blocked,
+        };
+
+    public:
+        SourceLimiter();
+        SourceLimiter(const SourceLimiter&) = delete;
+        ~SourceLimiter();
+
+        SourceLimiter& operator=(const SourceLimiter&) = delete;
+
+        void configure(const config::ptree& conf);
+        bool active() const;
+
+        Verdict admit(const transport::Address& a);
+        Verdict admit(const transport::Address& a, std::chrono::steady_clock::time_point now);
+
+        size_t tracked() const;
+
+    private:
+        void purge(std::chrono::steady_clock::time_point now);
+
+    private:
+        struct Bucket
+        {
+            double                                  _tokens {};
+            std::chrono::steady_clock::time_point   _last;
+            std::list<String>::iterator             _lru;
+        };
+
+        uint32                                  _rate = 0;     //per second, 0 - unlimited
+        uint32                                  _burst = 16;
+        std::unordered_set<String>              _blocked;
+
+        //least recently seen first, a new source beyond the limit pushes the first one out
+        std::unordered_map<String, Bucket>      _buckets;
+        std::list<String>                       _lru;
+        size_t                                  _bucketsLimit = 65536;
+
+        //oldest buckets looked at per admit for being refilled
+        static constexpr size_t                 _purgeStep = 2;
+    };
+}
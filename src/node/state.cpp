@@ -0,0 +1,141 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#include "pch.hpp"
+#include "state.hpp"
+#include "utils.hpp"
+
+namespace dci::module::ppn::node
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    State::State()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    State::~State()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void State::open(const std::filesystem::path& path)
+    {
+        _path = path;
+        _values.clear();
+
+        std::ifstream in{_path};
+        if(!in)
+        {
+            //absent yet, will be created on first change
+            return;
+        }
+
+        std::string line;
+        while(std::getline(in, line))
+        {
+            size_t pos = line.find(' ');
+            if(line.npos == pos || !pos)
+            {
+                LOGW("malformed node state line ignored: "<<line);
+                continue;
+            }
+
+            _values[line.substr(0, pos)] = line.substr(pos+1);
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool State::opened() const
+    {
+        return !_path.empty();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::optional<String> State::get(const String& key) const
+    {
+        auto iter = _values.find(key);
+        if(_values.end() == iter)
+        {
+            return {};
+        }
+
+        return iter->second;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void State::set(const String& key, const String& value)
+    {
+        dbgAssert(!key.empty() && key.npos == key.find_first_of(" \n"));
+        dbgAssert(value.npos == value.find('\n'));
+
+        String& v = _values[key];
+        if(v != value)
+        {
+            v = value;
+            save();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void State::erase(const String& key)
+    {
+        if(_values.erase(key))
+        {
+            save();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::vector<std::pair<String, String>> State::prefixed(const String& prefix) const
+    {
+        std::vector<std::pair<String, String>> res;
+
+        for(auto iter{_values.lower_bound(prefix)}; iter != _values.end() && iter->first.starts_with(prefix); ++iter)
+        {
+            res.emplace_back(*iter);
+        }
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void State::save()
+    {
+        if(!opened())
+        {
+            return;
+        }
+
+        namespace fs = std::filesystem;
+
+        fs::path tmp = _path;
+        tmp += ".tmp";
+
+        std::string content;
+        for(const auto&[k, v] : _values)
+        {
+            content += k;
+            content += ' ';
+            content += v;
+            content += '\n';
+        }
+
+        std::error_code ec;
+        if(!utils::writeOwnerOnly(tmp, content, ec))
+        {
+            LOGW("unable to write node state "<<tmp.string()<<": "<<ec.message());
+            return;
+        }
+
+        fs::rename(tmp, _path, ec);
+        if(ec)
+        {
+            LOGW("unable to write node state "<<_path.string()<<": "<<ec.message());
+        }
+    }
+}
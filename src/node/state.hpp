@@ -0,0 +1,38 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#pragma once
+
+#include "pch.hpp"
+
+namespace dci::module::ppn::node
+{
+    //small persistent key-value storage, survives node restarts
+    class State
+    {
+    public:
+        State();
+        ~State();
+
+        void open(const std::filesystem::path& path);
+        bool opened() const;
+
+        std::optional<String> get(const String& key) const;
+        void set(const String& key, const String& value);
+        void erase(const String& key);
+
+        std::vector<std::pair<String, String>> prefixed(const String& prefix) const;
+
+    private:
+        void save();
+
+    private:
+        std::filesystem::path   _path;
+        Map<String, String>     _values;
+    };
+}
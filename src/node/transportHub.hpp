@@ -10,6 +10,8 @@
 #include "pch.hpp"
 #include "netEnumerator.hpp"
 #include "utils.hpp"
+#include "state.hpp"
+#include "sim.hpp"
 
 namespace dci::module::ppn::node
 {
@@ -18,7 +20,7 @@ namespace dci::module::ppn::node
         : public sbs::Owner
     {
     public:
-        using LoMaker = std::function<Lo(const transport::Address&)>;
+        using LoMaker = std::function<Lo(const transport::Address&, const config::ptree& options)>;
         using AddressFixer = std::function<transport::Address(const transport::Address&)>;
 
     public:
@@ -30,11 +32,21 @@ namespace dci::module::ppn::node
                 AddressFixer addressFixer,
                 LoMaker loMaker,
                 const auto& conf,
-                const auto& netEnumeratorProvider);
-        void stop();
+                const auto& netEnumeratorProvider,
+                State& state,
+                const String& name);
+        //lo transports are detached from hi and, if parker is given, handed to it instead of released
+        void stop(const std::function<void(const transport::Address&, Lo&&)>& parker = {});
 
         Hi hi() const;
 
+        //lo to dial the target from: the one on the target's subnet by the longest common prefix,
+        //else one of the same family and reach; the least address wins among equals
+        Lo loForTarget(const transport::Address& target) const;
+
+        //live lo transports
+        size_t loAmount() const;
+
         sbs::Signal<void, transport::Address> loAdded();
         sbs::Signal<void, transport::Address> loDeleted();
 
@@ -46,12 +58,18 @@ namespace dci::module::ppn::node
         void autoConfIp(
                 const auto& conf,
                 const auto& netEnumeratorProvider,
-                uint32 scope);
+                uint32 scope,
+                const config::ptree& options);
 
     private:
-        template <class I> void addLo(const std::pair<I,I>& range);
-        void addLo(transport::Address&& a);
-        void delLo(transport::Address&& a);
+        template <class I> void addLo(const std::pair<I,I>& range, const config::ptree& options);
+        void addLo(transport::Address&& a, const config::ptree& options);
+        void addLo(transport::Address&& key, const String& host, const std::vector<String>& ports, const String& portKey, const config::ptree& options);
+        void delLo(transport::Address&& key);
+
+        static uint32 scopeKey(uint32 scope);
+        void scopeIndexAdd(const transport::Address& a, uint32 scope, const Lo& lo);
+        void scopeIndexDel(const transport::Address& a, uint32 scope);
 
     private:
         Hi  _hi;
@@ -61,14 +79,22 @@ namespace dci::module::ppn::node
 
         struct LoInstance
         {
-            size_t  _useCounter = 0;
-            Lo      _lo;
+            size_t              _useCounter = 0;
+            Lo                  _lo;
+            transport::Address  _address;
+            uint32              _scope = 0;
         };
 
-        Map<transport::Address, LoInstance> _loInstances;
+        utils::AddressMap<LoInstance> _loInstances;
+
+        //family and reach bits -> address -> lo, ordered to pick the same lo every time
+        Map<uint32, Map<String, Lo>> _loByScope;
 
         AddressFixer    _addressFixer;
         LoMaker         _loMaker;
+
+        State *         _state {};
+        String          _name;
     };
 
 
@@ -92,36 +118,47 @@ namespace dci::module::ppn::node
             AddressFixer addressFixer,
             LoMaker loMaker,
             const auto& conf,
-            const auto& netEnumeratorProvider)
+            const auto& netEnumeratorProvider,
+            State& state,
+            const String& name)
     {
         _hi = std::move(hi);
         _addressFixer = addressFixer;
         _loMaker = loMaker;
+        _state = &state;
+        _name = name;
 
         autoConf(conf, netEnumeratorProvider);
 
-        addLo(conf.equal_range("custom"));
+        addLo(conf.equal_range("custom"), conf.get_child("socket", config::ptree{}));
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     template <class Hi, class Lo>
-    void TransportHub<Hi, Lo>::stop()
+    void TransportHub<Hi, Lo>::stop(const std::function<void(const transport::Address&, Lo&&)>& parker)
     {
         flush();
 
         if(_hi)
         {
-            for(const auto&[a, i]: _loInstances)
+            for(auto&[a, i]: _loInstances)
             {
                 if(i._lo)
                 {
                     _hi->del(i._lo);
-                    _loDeleted.in(a);
+                    _loDeleted.in(i._address);
+
+                    //by the address it was made for, the one the successor asks the maker for
+                    if(parker)
+                    {
+                        parker(i._address, std::move(i._lo));
+                    }
                 }
             }
         }
 
         _loInstances.clear();
+        _loByScope.clear();
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
@@ -131,6 +168,70 @@ namespace dci::module::ppn::node
         return _hi;
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class Hi, class Lo>
+    Lo TransportHub<Hi, Lo>::loForTarget(const transport::Address& target) const
+    {
+        constexpr uint32 families = static_cast<uint32>(dci::utils::ip::Scope::ip4) | static_cast<uint32>(dci::utils::ip::Scope::ip6);
+
+        uint32 key = scopeKey(utils::addressScope(target));
+        if(!key)
+        {
+            return Lo{};
+        }
+
+        //netmasks are not known here, a common prefix of a typical lan subnet counts as the same subnet
+        const uint32 subnetBits = (key & static_cast<uint32>(dci::utils::ip::Scope::ip4)) ? 24 : 64;
+
+        const Lo* subnet{};
+        uint32 subnetBest{};
+        const Lo* scoped{};
+        uint32 scopedBest{};
+
+        for(const auto&[k, byAddress] : _loByScope)
+        {
+            if((k & families) != (key & families))
+            {
+                continue;
+            }
+
+            //ordered by address, strict comparison keeps the least one among equals
+            for(const auto&[a, lo] : byAddress)
+            {
+                uint32 bits = utils::addressCommonBits(transport::Address{a}, target);
+
+                if(bits >= subnetBits && (!subnet || bits > subnetBest))
+                {
+                    subnet = &lo;
+                    subnetBest = bits;
+                }
+
+                if(k == key && (!scoped || bits > scopedBest))
+                {
+                    scoped = &lo;
+                    scopedBest = bits;
+                }
+            }
+        }
+
+        if(subnet) return *subnet;
+        if(scoped) return *scoped;
+        return Lo{};
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class Hi, class Lo>
+    size_t TransportHub<Hi, Lo>::loAmount() const
+    {
+        size_t res{};
+        for(const auto&[k, i] : _loInstances)
+        {
+            if(i._lo) res++;
+        }
+
+        return res;
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     template <class Hi, class Lo>
     sbs::Signal<void, transport::Address> TransportHub<Hi, Lo>::loAdded()
@@ -151,24 +252,26 @@ namespace dci::module::ppn::node
             const auto& conf,
             const auto& netEnumeratorProvider)
     {
+        config::ptree options = conf.get_child("socket", config::ptree{});
+
         if(utils::parseBool(conf.get("inproc", "true")))
         {
-            addLo(_addressFixer(transport::Address{"inproc://%auto%"}));
+            addLo(_addressFixer(transport::Address{"inproc://%auto%"}), options);
         }
 
         if(utils::parseBool(conf.get("local", "true")))
         {
-            addLo(_addressFixer(transport::Address{"local://%auto%"}));
+            addLo(_addressFixer(transport::Address{"local://%auto%"}), options);
         }
 
         if(utils::parseBool(conf.get("ip4", "true")))
         {
-            autoConfIp(conf.get_child("ip4", decltype(conf){}), netEnumeratorProvider, static_cast<uint32>(dci::utils::ip::Scope::ip4));
+            autoConfIp(conf.get_child("ip4", decltype(conf){}), netEnumeratorProvider, static_cast<uint32>(dci::utils::ip::Scope::ip4), options);
         }
 
         if(utils::parseBool(conf.get("ip6", "true")))
         {
-            autoConfIp(conf.get_child("ip6", decltype(conf){}), netEnumeratorProvider, static_cast<uint32>(dci::utils::ip::Scope::ip6));
+            autoConfIp(conf.get_child("ip6", decltype(conf){}), netEnumeratorProvider, static_cast<uint32>(dci::utils::ip::Scope::ip6), options);
         }
     }
 
@@ -176,9 +279,12 @@ namespace dci::module::ppn::node
     template <class Hi, class Lo>
     void TransportHub<Hi, Lo>::autoConfIp(const auto& conf,
             const auto& netEnumeratorProvider,
-            uint32 scope)
+            uint32 scope,
+            const config::ptree& options)
     {
-        std::string port = conf.get("port", "");
+        std::string portSpec = conf.get("port", "");
+        std::vector<String> ports = utils::parsePorts(portSpec);
+        config::ptree scopeOptions = utils::mergeOptions(options, conf.get_child("socket", config::ptree{}));
 
         uint32 scopes = 0;
         if(utils::parseBool(conf.get("host", "true"))) scopes |= static_cast<uint32>(dci::utils::ip::Scope::host);
@@ -186,7 +292,7 @@ namespace dci::module::ppn::node
         if(utils::parseBool(conf.get("lan" , "true"))) scopes |= static_cast<uint32>(dci::utils::ip::Scope::lan );
         if(utils::parseBool(conf.get("wan" , "true"))) scopes |= static_cast<uint32>(dci::utils::ip::Scope::wan );
 
-        auto filter = [=](const NetEnumerator::Address& a, transport::Address& ta)
+        auto filter = [=](const NetEnumerator::Address& a, std::string& host)
         {
             if(!(static_cast<uint32>(a._scope) & scope))
             {
@@ -200,56 +306,68 @@ namespace dci::module::ppn::node
 
             if(static_cast<uint32>(a._scope) & static_cast<uint32>(dci::utils::ip::Scope::ip4))
             {
-                ta.value = "tcp4://" + a._value + (port.empty() ? port : ":"+port);
+                host = "tcp4://" + a._value;
             }
             else if(static_cast<uint32>(a._scope) & static_cast<uint32>(dci::utils::ip::Scope::ip6))
             {
-                ta.value = "tcp6://[" + a._value + "]" + (port.empty() ? port : ":"+port);
+                host = "tcp6://[" + a._value + "]";
             }
             else
             {
                 dbgFatal("never here");
-                ta.value = "tcp://" + a._value + (port.empty() ? port : ":"+port);
+                host = "tcp://" + a._value;
             }
 
             return true;
         };
 
+        //instances are keyed by the whole port spec, actual port is chosen at bind time
+        auto key = [=](const std::string& host)
+        {
+            return transport::Address{host + (portSpec.empty() ? portSpec : ":"+portSpec)};
+        };
+
+        //the port worked is remembered per host, interfaces may have different ports taken
+        auto portKey = [=,this](const std::string& host)
+        {
+            return _name + ".port." + host;
+        };
+
         NetEnumerator& neEnumerator = netEnumeratorProvider();
         neEnumerator.add() += this * [=,this](const NetEnumerator::Address& a)
         {
-            transport::Address ta;
-            if(filter(a, ta)) addLo(std::move(ta));
+            std::string host;
+            if(filter(a, host)) addLo(key(host), host, ports, portKey(host), scopeOptions);
         };
 
         neEnumerator.del() += this * [=,this](const NetEnumerator::Address& a)
         {
-            transport::Address ta;
-            if(filter(a, ta)) delLo(std::move(ta));
+            std::string host;
+            if(filter(a, host)) delLo(key(host));
         };
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     template <class Hi, class Lo>
     template <class I>
-    void TransportHub<Hi, Lo>::addLo(const std::pair<I,I>& range)
+    void TransportHub<Hi, Lo>::addLo(const std::pair<I,I>& range, const config::ptree& options)
     {
         for(auto iter(range.first); iter!=range.second; ++iter)
         {
             std::string addr = iter->second.data();
 
-            if(!dci::utils::uri::valid(addr))
+            if(!dci::utils::uri::valid(addr) && !Sim::is(transport::Address{addr}))
             {
                 throw api::Error("bad address value in config: "+addr);
             }
 
-            addLo(transport::Address{addr});
+            addLo(transport::Address{addr}, utils::mergeOptions(options, iter->second.get_child("socket", config::ptree{})));
         }
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     template <class Hi, class Lo>
-    void TransportHub<Hi, Lo>::addLo(transport::Address&& a)
+    void TransportHub<Hi, Lo>::addLo(transport::Address&& a, const config::ptree& options)
     {
         LoInstance& i = _loInstances[a];
         i._useCounter++;
@@ -257,9 +375,11 @@ namespace dci::module::ppn::node
         {
             try
             {
-                i._lo = _loMaker(a);
+                i._lo = _loMaker(a, options);
                 if(i._lo)
                 {
+                    i._address = a;
+                    i._scope = utils::addressScope(a);
                     i._lo.involvedChanged() += this * [a2=a,this](bool v) mutable
                     {
                         if(!v)
@@ -268,6 +388,7 @@ namespace dci::module::ppn::node
                         }
                     };
                     _hi->add(i._lo);
+                    scopeIndexAdd(a, i._scope, i._lo);
                     _loAdded.in(a);
                 }
             }
@@ -282,9 +403,93 @@ namespace dci::module::ppn::node
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     template <class Hi, class Lo>
-    void TransportHub<Hi, Lo>::delLo(transport::Address&& a)
+    void TransportHub<Hi, Lo>::addLo(transport::Address&& key, const String& host, const std::vector<String>& ports, const String& portKey, const config::ptree& options)
     {
-        auto iter = _loInstances.find(a);
+        LoInstance& i = _loInstances[key];
+        i._useCounter++;
+        if(i._lo)
+        {
+            return;
+        }
+
+        //the port worked last time goes first
+        std::vector<String> candidates = ports;
+        if(std::optional<String> preferred = _state->get(portKey))
+        {
+            auto iter = std::find(candidates.begin(), candidates.end(), *preferred);
+            if(candidates.end() != iter)
+            {
+                std::rotate(candidates.begin(), iter, std::next(iter));
+            }
+        }
+
+        ExceptionPtr lastError;
+        for(const String& port : candidates)
+        {
+            transport::Address a{host + (port.empty() ? port : ":"+port)};
+
+            try
+            {
+                try
+                {
+                    i._lo = _loMaker(a, options);
+                }
+                catch(...)
+                {
+                    //a busy port moves to the next candidate, anything else is a real failure
+                    if(!utils::addressBusy(std::current_exception()))
+                    {
+                        throw;
+                    }
+
+                    lastError = std::current_exception();
+                    continue;
+                }
+
+                if(i._lo)
+                {
+                    if(candidates.size() > 1)
+                    {
+                        _state->set(portKey, port);
+                    }
+
+                    i._address = a;
+                    i._scope = utils::addressScope(a);
+                    i._lo.involvedChanged() += this * [key,this](bool v) mutable
+                    {
+                        if(!v)
+                        {
+                            delLo(std::move(key));
+                        }
+                    };
+                    _hi->add(i._lo);
+                    scopeIndexAdd(a, i._scope, i._lo);
+                    _loAdded.in(a);
+                }
+            }
+            catch(...)
+            {
+                std::rethrow_exception(
+                            exception::buildInstance<api::Error>(std::current_exception(), "unable to use address: "+a.value)
+                            );
+            }
+
+            return;
+        }
+
+        if(lastError)
+        {
+            std::rethrow_exception(
+                        exception::buildInstance<api::Error>(lastError, "unable to use address: "+key.value)
+                        );
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class Hi, class Lo>
+    void TransportHub<Hi, Lo>::delLo(transport::Address&& key)
+    {
+        auto iter = _loInstances.find(key);
         if(_loInstances.end() == iter)
         {
             return;
@@ -300,9 +505,56 @@ namespace dci::module::ppn::node
 
         if(i._lo)
         {
+            scopeIndexDel(i._address, i._scope);
             _hi->del(i._lo);
-            _loDeleted.in(a);
+            _loDeleted.in(i._address);
         }
         _loInstances.erase(iter);
     }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class Hi, class Lo>
+    uint32 TransportHub<Hi, Lo>::scopeKey(uint32 scope)
+    {
+        constexpr uint32 families = static_cast<uint32>(dci::utils::ip::Scope::ip4) | static_cast<uint32>(dci::utils::ip::Scope::ip6);
+        constexpr uint32 reaches =
+                static_cast<uint32>(dci::utils::ip::Scope::host) |
+                static_cast<uint32>(dci::utils::ip::Scope::link) |
+                static_cast<uint32>(dci::utils::ip::Scope::lan) |
+                static_cast<uint32>(dci::utils::ip::Scope::wan);
+
+        if(!(scope & families) || !(scope & reaches))
+        {
+            return 0;
+        }
+
+        return scope & (families | reaches);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class Hi, class Lo>
+    void TransportHub<Hi, Lo>::scopeIndexAdd(const transport::Address& a, uint32 scope, const Lo& lo)
+    {
+        if(uint32 key = scopeKey(scope))
+        {
+            _loByScope[key][a.value] = lo;
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class Hi, class Lo>
+    void TransportHub<Hi, Lo>::scopeIndexDel(const transport::Address& a, uint32 scope)
+    {
+        auto iter = _loByScope.find(scopeKey(scope));
+        if(_loByScope.end() == iter)
+        {
+            return;
+        }
+
+        iter->second.erase(a.value);
+        if(iter->second.empty())
+        {
+            _loByScope.erase(iter);
+        }
+    }
 }
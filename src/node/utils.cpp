@@ -20,11 +20,17 @@
 #   include <ioapiset.h>
 #   include <iptypes.h>
 #   include <iphlpapi.h>
+#   include <ws2tcpip.h>
 #else
 #   include <sys/utsname.h>
 #   include <pwd.h>
+#   include <arpa/inet.h>
+#   include <fcntl.h>
+#   include <unistd.h>
 #endif
 
+#include <thread>
+
 namespace dci::module::ppn::node::utils
 {
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
@@ -44,10 +50,66 @@ namespace dci::module::ppn::node::utils
 
     namespace
     {
-        const std::map<String, std::function<void(const config::ptree& config, crypto::Blake2b& accumuler)>> keyMaterialFetchers =
+        //accumulator calls of a fetcher running aside, replayed into the real one in the fixed order,
+        //so the digest is the same as if the fetchers had run one by one
+        class KeyMaterial
         {
+        public:
+            template <class T>
+            void add(const T& v)
+            {
+                if constexpr(std::is_pointer_v<T>)
+                {
+                    //c strings, the pointee may not outlive the fetcher (getpwuid and alike)
+                    using C = std::remove_cv_t<std::remove_pointer_t<T>>;
+                    std::basic_string<C> copy{v};
+                    _ops.emplace_back([copy=std::move(copy)](crypto::Blake2b& accumuler)
+                    {
+                        accumuler.add(copy.c_str());
+                    });
+                }
+                else
+                {
+                    _ops.emplace_back([v](crypto::Blake2b& accumuler)
+                    {
+                        accumuler.add(v);
+                    });
+                }
+            }
+
+            void add(const void* data, std::size_t size)
             {
-                "memInfo", [](const config::ptree&, crypto::Blake2b& accumuler)
+                std::vector<uint8> copy{static_cast<const uint8*>(data), static_cast<const uint8*>(data) + size};
+                _ops.emplace_back([copy=std::move(copy)](crypto::Blake2b& accumuler)
+                {
+                    accumuler.add(static_cast<const void*>(copy.data()), copy.size());
+                });
+            }
+
+            void barrier()
+            {
+                _ops.emplace_back([](crypto::Blake2b& accumuler)
+                {
+                    accumuler.barrier();
+                });
+            }
+
+            void replay(crypto::Blake2b& accumuler) const
+            {
+                for(const auto& op : _ops)
+                {
+                    op(accumuler);
+                }
+            }
+
+        private:
+            std::vector<std::function<void(crypto::Blake2b&)>> _ops;
+        };
+
+        const std::map<String, std::function<void(const config::ptree& config, KeyMaterial& accumuler)>> keyMaterialFetchers =
+        {
+            {
+                "memInfo", [](const config::ptree&, KeyMaterial& accumuler)
                 {
 #ifdef _WIN32
                     MEMORYSTATUSEX mem{};
@@ -80,7 +142,7 @@ namespace dci::module::ppn::node::utils
                 }
             },
             {
-                "cpuInfo", [](const config::ptree&, crypto::Blake2b& accumuler)
+                "cpuInfo", [](const config::ptree&, KeyMaterial& accumuler)
                 {
 #ifdef _WIN32
                     {
@@ -135,7 +197,7 @@ namespace dci::module::ppn::node::utils
                 }
             },
             {
-                "diskInfo", [](const config::ptree&, crypto::Blake2b& accumuler)
+                "diskInfo", [](const config::ptree&, KeyMaterial& accumuler)
                 {
 #ifdef _WIN32
                     std::set<std::wstring> drives;
@@ -366,7 +428,7 @@ namespace dci::module::ppn::node::utils
                 }
             },
             {
-                "netMacAddress", [](const config::ptree&, crypto::Blake2b& accumuler)
+                "netMacAddress", [](const config::ptree&, KeyMaterial& accumuler)
                 {
 #ifdef _WIN32
                     ULONG outBufLen{};
@@ -428,7 +490,7 @@ namespace dci::module::ppn::node::utils
                 }
             },
             {
-                "osInfo", [](const config::ptree&, crypto::Blake2b& accumuler)
+                "osInfo", [](const config::ptree&, KeyMaterial& accumuler)
                 {
 #ifdef _WIN32
                     OSVERSIONINFOEXW buf{};
@@ -483,7 +545,7 @@ namespace dci::module::ppn::node::utils
                 }
             },
             {
-                "appPath", [](const config::ptree&, crypto::Blake2b& accumuler)
+                "appPath", [](const config::ptree&, KeyMaterial& accumuler)
                 {
 #ifdef _WIN32
                     WCHAR path[2048]{};
@@ -504,7 +566,7 @@ namespace dci::module::ppn::node::utils
                 }
             },
             {
-                "appPid", [](const config::ptree&, crypto::Blake2b& accumuler)
+                "appPid", [](const config::ptree&, KeyMaterial& accumuler)
                 {
 #ifdef _WIN32
                     accumuler.add(GetCurrentProcessId());
@@ -514,7 +576,7 @@ namespace dci::module::ppn::node::utils
                 }
             },
             {
-                "domainname", [](const config::ptree&, crypto::Blake2b& accumuler)
+                "domainname", [](const config::ptree&, KeyMaterial& accumuler)
                 {
 #ifdef _WIN32
                     WCHAR buf[256];
@@ -535,7 +597,7 @@ namespace dci::module::ppn::node::utils
                 }
             },
             {
-                "hostname", [](const config::ptree&, crypto::Blake2b& accumuler)
+                "hostname", [](const config::ptree&, KeyMaterial& accumuler)
                 {
    #ifdef _WIN32
                     WCHAR buf[256];
@@ -556,7 +618,7 @@ namespace dci::module::ppn::node::utils
                 }
             },
             {
-                "username", [](const config::ptree&, crypto::Blake2b& accumuler)
+                "username", [](const config::ptree&, KeyMaterial& accumuler)
                 {
 #ifdef _WIN32
                     WCHAR buf[256];
@@ -609,7 +671,7 @@ namespace dci::module::ppn::node::utils
                 }
             },
             {
-                "random", [](const config::ptree&, crypto::Blake2b& accumuler)
+                "random", [](const config::ptree&, KeyMaterial& accumuler)
                 {
                     char buf[256];
                     if(!crypto::rnd::generate(buf, sizeof(buf)))
@@ -620,7 +682,7 @@ namespace dci::module::ppn::node::utils
                 }
             },
             {
-                "constant", [](const config::ptree& config, crypto::Blake2b& accumuler)
+                "constant", [](const config::ptree& config, KeyMaterial& accumuler)
                 {
                     accumuler.add(config.get_value(String{}));
                 }
@@ -633,21 +695,25 @@ namespace dci::module::ppn::node::utils
     {
         api::link::Key res;
 
-        crypto::Blake2b accumuler{res.size()};
+        struct Job
+        {
+            String                                  _kind;
+            config::ptree                           _conf;
+            const decltype(keyMaterialFetchers)::mapped_type* _fetcher {};
+            KeyMaterial                             _material;
+            std::exception_ptr                      _error;
+        };
+        std::vector<Job> jobs;
 
         auto tryOne = [&](const String& kind, const config::ptree& conf = config::ptree{})
         {
             auto iter = keyMaterialFetchers.find(kind);
-            if(keyMaterialFetchers.end() != iter)
-            {
-                accumuler.add(kind);
-                iter->second(conf, accumuler);
-                accumuler.barrier();
-            }
-            else
+            if(keyMaterialFetchers.end() == iter)
             {
                 throw api::Error("ppn node: bad key material kind: "+kind);
             }
+
+            jobs.push_back(Job{kind, conf, &iter->second, {}, {}});
         };
 
         {
@@ -679,11 +745,230 @@ namespace dci::module::ppn::node::utils
             tryOne(kind, child);
         }
 
+        //fetchers run concurrently, each into its own material
+        {
+            std::vector<std::thread> threads;
+            threads.reserve(jobs.size());
+            for(Job& job : jobs)
+            {
+                threads.emplace_back([&job]
+                {
+                    try
+                    {
+                        (*job._fetcher)(job._conf, job._material);
+                    }
+                    catch(...)
+                    {
+                        job._error = std::current_exception();
+                    }
+                });
+            }
+
+            for(std::thread& t : threads)
+            {
+                t.join();
+            }
+        }
+
+        //and are accumulated in the fixed order, the first failure in that order wins as before
+        crypto::Blake2b accumuler{res.size()};
+        for(const Job& job : jobs)
+        {
+            if(job._error)
+            {
+                std::rethrow_exception(job._error);
+            }
+
+            accumuler.add(job._kind);
+            job._material.replay(accumuler);
+            accumuler.barrier();
+        }
+
         dbgAssert(accumuler.digestSize() == res.size());
         accumuler.finish(res.data());
         return res;
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::optional<String> keyFingerprint(const config::ptree& config)
+    {
+#ifdef _WIN32
+        (void)config;
+        return {};
+#else
+        crypto::Blake2b accumuler{32};
+
+        bool reproducible = true;
+        auto walk = [&](auto& self, const String& kind, const config::ptree& conf) -> void
+        {
+            String value = conf.get_value(String{});
+
+            if("random" == kind || "appPid" == kind || "random" == value || "appPid" == value)
+            {
+                reproducible = false;
+            }
+
+            accumuler.add(kind);
+            accumuler.barrier();
+            accumuler.add(value);
+            accumuler.barrier();
+
+            for(const auto&[k, child] : conf)
+            {
+                self(self, k, child);
+            }
+        };
+        walk(walk, String{"key"}, config);
+
+        if(!reproducible)
+        {
+            return {};
+        }
+
+        //changes on every boot, so hardware facts are reread at least once per boot
+        {
+            std::ifstream in{"/proc/sys/kernel/random/boot_id"};
+            std::string line;
+            if(!in || !std::getline(in, line) || line.empty())
+            {
+                return {};
+            }
+            accumuler.add(line);
+            accumuler.barrier();
+        }
+
+        {
+            char path[PATH_MAX+1]{};
+            if(0 > readlink("/proc/self/exe", path, PATH_MAX))
+            {
+                return {};
+            }
+            accumuler.add(path);
+            accumuler.barrier();
+        }
+
+        {
+            char name[256] = {0};
+            gethostname(name, sizeof(name)-1);
+            accumuler.add(name);
+            accumuler.barrier();
+
+            name[0] = 0;
+            getdomainname(name, sizeof(name)-1);
+            accumuler.add(name);
+            accumuler.barrier();
+        }
+
+        accumuler.add(geteuid());
+        accumuler.barrier();
+
+        if(const char* user = getenv("USER"))
+        {
+            accumuler.add(user);
+        }
+        accumuler.barrier();
+
+        std::array<uint8, 32> digest;
+        dbgAssert(accumuler.digestSize() == digest.size());
+        accumuler.finish(digest.data());
+        return toHex(digest.data(), digest.size());
+#endif
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool writeOwnerOnly(const std::filesystem::path& path, const String& content, std::error_code& ec)
+    {
+#ifdef _WIN32
+        std::ofstream out{path, std::ios::trunc | std::ios::binary};
+        if(!out || !(out << content))
+        {
+            ec = std::error_code{errno, std::generic_category()};
+            return false;
+        }
+
+        return true;
+#else
+        //a file left from before is removed to not inherit its mode
+        ::unlink(path.c_str());
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        if(0 > fd)
+        {
+            ec = std::error_code{errno, std::generic_category()};
+            return false;
+        }
+
+        dci::utils::AtScopeExit closer{[fd]{::close(fd);}};
+
+        for(size_t done{}; done < content.size();)
+        {
+            ssize_t res = ::write(fd, content.data() + done, content.size() - done);
+            if(0 > res)
+            {
+                if(EINTR == errno)
+                {
+                    continue;
+                }
+
+                ec = std::error_code{errno, std::generic_category()};
+                return false;
+            }
+
+            done += static_cast<size_t>(res);
+        }
+
+        return true;
+#endif
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    String toHex(const void* data, size_t size)
+    {
+        static constexpr char digits[] = "0123456789abcdef";
+
+        String res;
+        res.reserve(size*2);
+
+        const uint8* bytes = static_cast<const uint8*>(data);
+        for(size_t i{}; i<size; ++i)
+        {
+            res.push_back(digits[bytes[i] >> 4]);
+            res.push_back(digits[bytes[i] & 0x0f]);
+        }
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool fromHex(const String& hex, void* data, size_t size)
+    {
+        if(hex.size() != size*2)
+        {
+            return false;
+        }
+
+        auto nibble = [](char c) -> int
+        {
+            if(c >= '0' && c <= '9') return c - '0';
+            if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        };
+
+        uint8* bytes = static_cast<uint8*>(data);
+        for(size_t i{}; i<size; ++i)
+        {
+            int h = nibble(hex[i*2]);
+            int l = nibble(hex[i*2+1]);
+            if(0 > h || 0 > l)
+            {
+                return false;
+            }
+            bytes[i] = static_cast<uint8>((h << 4) | l);
+        }
+
+        return true;
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     bool parseBool(const String& param)
     {
@@ -701,4 +986,304 @@ namespace dci::module::ppn::node::utils
     {
         return static_cast<uint16>(std::stoull(param));
     }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    uint32 parseUint32(const String& param)
+    {
+        return static_cast<uint32>(std::stoull(param));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::vector<String> parsePorts(const String& param)
+    {
+        static const std::regex single("^([0-9]{1,5})$", std::regex::optimize);
+        static const std::regex range("^([0-9]{1,5})-([0-9]{1,5})$", std::regex::optimize);
+        static constexpr size_t maxPorts = 4096;
+
+        std::vector<String> res;
+
+        std::string token;
+        std::istringstream in{std::regex_replace(param, std::regex{","}, " ")};
+        while(in >> token)
+        {
+            std::smatch m;
+            if(std::regex_match(token, m, single))
+            {
+                uint32 v = parseUint32(m[1]);
+                if(v > 65535)
+                {
+                    throw api::Error("bad node port value provided: "+token);
+                }
+
+                res.push_back(std::to_string(v));
+            }
+            else if(std::regex_match(token, m, range))
+            {
+                uint32 from = parseUint32(m[1]);
+                uint32 to = parseUint32(m[2]);
+                if(from > to || to > 65535 || to - from >= maxPorts)
+                {
+                    throw api::Error("bad node port range provided: "+token);
+                }
+
+                for(uint32 v{from}; v<=to; ++v)
+                {
+                    res.push_back(std::to_string(v));
+                }
+            }
+            else
+            {
+                throw api::Error("bad node port value provided: "+token);
+            }
+
+            if(res.size() > maxPorts)
+            {
+                throw api::Error("too many node ports provided: "+param);
+            }
+        }
+
+        if(res.empty())
+        {
+            //no port specified, the transport will choose
+            res.emplace_back();
+        }
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    config::ptree mergeOptions(const config::ptree& base, const config::ptree& over)
+    {
+        config::ptree res = base;
+        for(const auto&[key, value] : over)
+        {
+            res.put_child(key, value);
+        }
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void checkSocketOptions(const config::ptree& options)
+    {
+        enum class Kind { flag, size };
+        static const std::map<String, Kind> known =
+        {
+            {"backlog",     Kind::size},
+            {"nodelay",     Kind::flag},
+            {"sndbuf",      Kind::size},
+            {"rcvbuf",      Kind::size},
+            {"keepalive",   Kind::flag},
+            {"fastopen",    Kind::flag},
+        };
+
+        static const std::regex size("^[1-9][0-9]{0,9}$", std::regex::optimize);
+
+        for(const auto&[key, value] : options)
+        {
+            auto iter = known.find(key);
+            if(known.end() == iter)
+            {
+                throw api::Error("bad socket option in config: "+key);
+            }
+
+            const String& v = value.data();
+            switch(iter->second)
+            {
+            case Kind::flag:
+                parseBool(v);
+                break;
+
+            case Kind::size:
+                if(!std::regex_match(v, size) || std::stoull(v) > static_cast<uint64>(std::numeric_limits<int32>::max()))
+                {
+                    throw api::Error("bad socket option value in config: "+key+" "+v);
+                }
+                break;
+            }
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool tcpSocketOption(const String& key)
+    {
+        return "nodelay" == key || "keepalive" == key || "fastopen" == key;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool duplicateKeepNew(bool existingByConnect, bool existingClosing, bool newByConnect, bool ownIdLower)
+    {
+        if(existingClosing)
+        {
+            //otherwise the pair would end up with no connection at all
+            return true;
+        }
+
+        if(existingByConnect == newByConnect)
+        {
+            return false;
+        }
+
+        return newByConnect == ownIdLower;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool addressBusy(const ExceptionPtr& e)
+    {
+        try
+        {
+            std::rethrow_exception(e);
+        }
+        catch(const std::system_error& se)
+        {
+            if(std::errc::address_in_use == se.code())
+            {
+                return true;
+            }
+        }
+        catch(...)
+        {
+        }
+
+        //remote transports deliver the system error as a text only
+        String text = exception::toString(e);
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c){return std::tolower(c);});
+        return text.npos != text.find("address already in use") ||
+               text.npos != text.find("address in use") ||
+               text.npos != text.find("only one usage of each socket address");
+    }
+
+    namespace
+    {
+        std::optional<std::array<uint8, 4>> ip4Octets(const transport::Address& a)
+        {
+            std::string_view v = a.value;
+            if(!v.starts_with("tcp4://"))
+            {
+                return {};
+            }
+
+            v.remove_prefix(7);
+            std::string host{v.substr(0, v.find(':'))};
+
+            std::array<uint8, 4> octets;
+            if(1 != inet_pton(AF_INET, host.c_str(), octets.data()))
+            {
+                return {};
+            }
+
+            return octets;
+        }
+
+        std::optional<std::array<uint8, 16>> ip6Octets(const transport::Address& a)
+        {
+            std::string_view v = a.value;
+            if(!v.starts_with("tcp6://["))
+            {
+                return {};
+            }
+
+            v.remove_prefix(8);
+            std::string host{v.substr(0, std::min(v.find(']'), v.find('%')))};
+
+            std::array<uint8, 16> octets;
+            if(1 != inet_pton(AF_INET6, host.c_str(), octets.data()))
+            {
+                return {};
+            }
+
+            return octets;
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    uint32 addressScope(const transport::Address& a)
+    {
+        if(auto octets = ip4Octets(a))
+        {
+            return static_cast<uint32>(dci::utils::ip::scope(*octets));
+        }
+
+        if(auto octets = ip6Octets(a))
+        {
+            return static_cast<uint32>(dci::utils::ip::scope(*octets));
+        }
+
+        return 0;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    String addressPrefix(const transport::Address& a)
+    {
+        if(auto octets = ip4Octets(a))
+        {
+            return String{"4"} + String{reinterpret_cast<const char*>(octets->data()), 3};
+        }
+
+        if(auto octets = ip6Octets(a))
+        {
+            return String{"6"} + String{reinterpret_cast<const char*>(octets->data()), 7};
+        }
+
+        return {};
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    String addressHost(const transport::Address& a)
+    {
+        if(auto octets = ip4Octets(a))
+        {
+            return String{"4"} + String{reinterpret_cast<const char*>(octets->data()), octets->size()};
+        }
+
+        if(auto octets = ip6Octets(a))
+        {
+            return String{"6"} + String{reinterpret_cast<const char*>(octets->data()), octets->size()};
+        }
+
+        return {};
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    uint32 addressCommonBits(const transport::Address& a, const transport::Address& b)
+    {
+        String ha = addressHost(a);
+        String hb = addressHost(b);
+        if(ha.empty() || ha.size() != hb.size() || ha[0] != hb[0])
+        {
+            return 0;
+        }
+
+        uint32 res = 0;
+        for(std::size_t i{1}; i<ha.size(); ++i)
+        {
+            uint8 x = static_cast<uint8>(ha[i] ^ hb[i]);
+            if(!x)
+            {
+                res += 8;
+                continue;
+            }
+
+            while(!(x & 0x80))
+            {
+                res++;
+                x = static_cast<uint8>(x << 1);
+            }
+            break;
+        }
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    String addressScheme(const transport::Address& a)
+    {
+        std::size_t pos = a.value.find("://");
+        if(String::npos == pos)
+        {
+            return {};
+        }
+
+        return a.value.substr(0, pos);
+    }
 }
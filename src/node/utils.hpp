@@ -14,6 +14,71 @@ namespace dci::module::ppn::node::utils
     std::string mkRandomName(size_t chars);
 
     api::link::Key parseKey(const config::ptree& config);
+
+    //cheap digest of the key config and of the host facts the key material depends on,
+    //empty if the key is not reproducible (random, appPid) and must not be cached
+    std::optional<String> keyFingerprint(const config::ptree& config);
+
+    //created readable by the owner only from the very start, no window with a wider mode
+    bool writeOwnerOnly(const std::filesystem::path& path, const String& content, std::error_code& ec);
+
+    String toHex(const void* data, size_t size);
+    bool fromHex(const String& hex, void* data, size_t size);
     bool parseBool(const String& param);
     uint16 parseUint16(const String& param);
+    uint32 parseUint32(const String& param);
+    std::vector<String> parsePorts(const String& param);
+
+    config::ptree mergeOptions(const config::ptree& base, const config::ptree& over);
+    void checkSocketOptions(const config::ptree& options);
+
+    //nodelay, keepalive, fastopen - meaningful for tcp only
+    bool tcpSocketOption(const String& key);
+
+    //second remote of one id, true if the new one stays: simultaneous open keeps the connection
+    //initiated by the lower id on both sides, same direction keeps the one joined earlier, and
+    //the new one always stays if the existing is already closing
+    bool duplicateKeepNew(bool existingByConnect, bool existingClosing, bool newByConnect, bool ownIdLower);
+
+    //bind failed because the address is taken by someone else
+    bool addressBusy(const ExceptionPtr& e);
+
+    //dci::utils::ip::Scope bits of a tcp4/tcp6 address, 0 for others
+    uint32 addressScope(const transport::Address& a);
+
+    //binary key of the /24 of a tcp4 or the /56 of a tcp6 address, empty for others
+    String addressPrefix(const transport::Address& a);
+
+    //binary key of the host of a tcp4 or tcp6 address, empty for others
+    String addressHost(const transport::Address& a);
+
+    //leading bits two tcp4 or two tcp6 hosts have in common, 0 for different families and non-ip
+    uint32 addressCommonBits(const transport::Address& a, const transport::Address& b);
+
+    //"tcp4", "inproc", ..., the part before "://"
+    String addressScheme(const transport::Address& a);
+
+    struct AddressHash
+    {
+        size_t operator()(const transport::Address& a) const noexcept
+        {
+            return std::hash<String>{}(a.value);
+        }
+    };
+
+    struct AddressEqual
+    {
+        bool operator()(const transport::Address& a, const transport::Address& b) const noexcept
+        {
+            return a.value == b.value;
+        }
+    };
+
+    template <class V>
+    using AddressMap = std::unordered_map<transport::Address, V, AddressHash, AddressEqual>;
+
+    template <class V>
+    using AddressMultiMap = std::unordered_multimap<transport::Address, V, AddressHash, AddressEqual>;
+
+    using AddressSet = std::unordered_set<transport::Address, AddressHash, AddressEqual>;
 }
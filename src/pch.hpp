@@ -22,9 +22,17 @@
 #endif
 
 #include <regex>
+#include <deque>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
 #include <functional>
 #include <filesystem>
 #include <fstream>
+#include <sstream>
+#include <random>
+#include <cstring>
 #include <cstdio>
 #include "ppn/node.hpp"
 
@@ -0,0 +1,422 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+#include <dci/test.hpp>
+#include <dci/host.hpp>
+#include <dci/poll.hpp>
+#include <dci/config.hpp>
+#include "ppn/node.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <unistd.h>
+
+using namespace dci;
+using namespace dci::host;
+using namespace dci::cmt;
+
+using namespace dci::idl::ppn;
+
+namespace
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::string env(const char* name, const std::string& def)
+    {
+        const char* v = std::getenv(name);
+        return v && *v ? std::string{v} : def;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    size_t residentBytes()
+    {
+        std::ifstream in{"/proc/self/statm"};
+        size_t size{}, resident{};
+        in >> size >> resident;
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    config::ptree nodeConfig(size_t index, const std::string& features, const std::string& transport)
+    {
+        config::ptree conf;
+
+        conf.put("key", "constant");
+        conf.put("key.constant", "ppn-node-bench-" + std::to_string(index));
+
+        for(const char* side : {"accept", "connect"})
+        {
+            for(const char* t : {"inproc", "local", "ip4", "ip6"})
+            {
+                conf.put(std::string{side} + "." + t, transport == t ? "on" : "off");
+            }
+        }
+
+        //sim:// is carried by inproc with dial latency and faults, see the sim block of the node config
+        if("sim" == transport)
+        {
+            conf.add("accept.custom", "sim://ppn-node-bench-" + std::to_string(index));
+            conf.add("connect.custom", "sim://");
+
+            conf.put("sim.latency", env("PPN_NODE_BENCH_SIM_LATENCY", "20"));
+            conf.put("sim.jitter", env("PPN_NODE_BENCH_SIM_JITTER", "10"));
+            conf.put("sim.fail", env("PPN_NODE_BENCH_SIM_FAIL", "0.05"));
+            conf.put("sim.hang", env("PPN_NODE_BENCH_SIM_HANG", "0.01"));
+            conf.put("sim.hangFor", env("PPN_NODE_BENCH_SIM_HANGFOR", "5000"));
+            conf.put("sim.seed", std::to_string(index));
+        }
+
+        conf.put("natt.pmp", "off");
+        conf.put("natt.pcp", "off");
+        conf.put("natt.igdp", "off");
+
+        config::ptree& fs = conf.put_child("features", config::ptree{});
+        std::istringstream in{features};
+        std::string feature;
+        while(std::getline(in, feature, ','))
+        {
+            if(!feature.empty())
+            {
+                fs.push_back({feature, config::ptree{}});
+            }
+        }
+
+        return conf;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    struct BenchNode
+    {
+        idl::host::Daemon<> _daemon;
+        Node<>              _node;
+        sbs::Owner          _sbsOwner;
+        size_t              _remotes {};
+
+        //received bytes by remotes() snapshots: live remotes as last seen, closed ones as last seen before close
+        std::map<node::link::Id, uint64>    _bytesLive;
+        uint64                              _bytesClosed {};
+
+        uint64 bytes() const
+        {
+            uint64 res = _bytesClosed;
+            for(const auto&[id, b] : _bytesLive) res += b;
+            return res;
+        }
+    };
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::unique_ptr<BenchNode> startNode(size_t index, const std::string& features, const std::string& transport = "inproc")
+    {
+        std::unique_ptr<BenchNode> bn{new BenchNode};
+
+        idl::Interface service = testManager()->createService("ppn::Node").value();
+        bn->_daemon = service;
+        if(!bn->_daemon)
+        {
+            return {};
+        }
+
+        bn->_daemon->start(config::cnvt(nodeConfig(index, features, transport))).value();
+        bn->_node = bn->_daemon->service().value();
+        if(!bn->_node)
+        {
+            return {};
+        }
+
+        return bn;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void stopNodes(std::vector<std::unique_ptr<BenchNode>>& nodes)
+    {
+        for(std::unique_ptr<BenchNode>& bn : nodes)
+        {
+            bn->_sbsOwner.flush();
+            bn->_daemon->stop().value();
+        }
+        nodes.clear();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void benchJoin(const std::string& transport)
+    {
+        const size_t nodesAmount = std::stoul(env("PPN_NODE_BENCH_NODES", "8"));
+        const std::string features = env("PPN_NODE_BENCH_FEATURES", "ppn::discovery::local::ProcessScope,ppn::connectivity::Joining,ppn::connectivity::Demand");
+        const std::chrono::seconds timeout{std::stoul(env("PPN_NODE_BENCH_TIMEOUT", "60"))};
+        const size_t meshRemotes = nodesAmount * (nodesAmount - 1);
+
+        std::vector<std::unique_ptr<BenchNode>> nodes;
+        std::vector<uint64> joinDurations;
+        size_t remotes{};
+
+        cmt::Promise<void> done;
+        bool finished{};
+        auto begin = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point meshReached{};
+
+        const size_t rssBefore = residentBytes();
+
+        for(size_t i{}; i<nodesAmount; ++i)
+        {
+            std::unique_ptr<BenchNode> bn = startNode(i, features, transport);
+            ASSERT_TRUE(bn);
+
+            BenchNode* raw = bn.get();
+            bn->_node->remoteJoined() += raw->_sbsOwner * [&, raw](const node::link::Id&, bool, uint64 duration)
+            {
+                joinDurations.push_back(duration);
+                raw->_remotes++;
+                remotes++;
+
+                if(remotes >= meshRemotes && !finished)
+                {
+                    finished = true;
+                    meshReached = std::chrono::steady_clock::now();
+                    done.resolveValue();
+                }
+            };
+
+            bn->_node->remoteClosed() += raw->_sbsOwner * [&, raw](const node::link::Id&)
+            {
+                raw->_remotes--;
+                remotes--;
+            };
+
+            nodes.emplace_back(std::move(bn));
+        }
+
+        poll::Timer timer{timeout, false, [&]
+        {
+            if(!finished)
+            {
+                finished = true;
+                done.resolveValue();
+            }
+        }};
+        timer.start();
+
+        done.future().value();
+        timer.stop();
+
+        const size_t rssAfter = residentBytes();
+        const double elapsed = std::chrono::duration<double>(
+                                   (meshReached == std::chrono::steady_clock::time_point{} ? std::chrono::steady_clock::now() : meshReached) - begin).count();
+
+        std::sort(joinDurations.begin(), joinDurations.end());
+        auto percentile = [&](double p) -> uint64
+        {
+            if(joinDurations.empty()) return 0;
+            return joinDurations[std::min(joinDurations.size()-1, static_cast<size_t>(p * static_cast<double>(joinDurations.size())))];
+        };
+
+        std::cout << "transport:         " << transport << std::endl;
+        std::cout << "nodes:             " << nodesAmount << std::endl;
+        std::cout << "features:          " << features << std::endl;
+        std::cout << "full mesh:         " << (meshReached == std::chrono::steady_clock::time_point{} ? "not reached" : "reached") << std::endl;
+        std::cout << "remotes:           " << remotes << " of " << meshRemotes << std::endl;
+        std::cout << "elapsed, s:        " << elapsed << std::endl;
+        std::cout << "joins:             " << joinDurations.size() << std::endl;
+        std::cout << "joins per second:  " << (elapsed > 0 ? static_cast<double>(joinDurations.size()) / elapsed : 0.0) << std::endl;
+        std::cout << "join p50, us:      " << percentile(0.50) << std::endl;
+        std::cout << "join p90, us:      " << percentile(0.90) << std::endl;
+        std::cout << "join p99, us:      " << percentile(0.99) << std::endl;
+        std::cout << "bytes per remote:  " << (remotes ? (rssAfter > rssBefore ? rssAfter - rssBefore : 0) / remotes : 0) << std::endl;
+
+        stopNodes(nodes);
+    }
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+// N nodes in one process, reports join throughput, join latency percentiles,
+// time to full mesh and memory per remote as the resident set growth of the
+// whole process divided by the remotes joined.
+// PPN_NODE_BENCH_NODES     nodes amount, the bench is skipped if not set
+// PPN_NODE_BENCH_FEATURES  comma separated feature list
+// PPN_NODE_BENCH_TIMEOUT   seconds to wait for the full mesh
+TEST(module_ppn_node, bench_join)
+{
+    if(env("PPN_NODE_BENCH_NODES", "").empty())
+    {
+        GTEST_SKIP() << "PPN_NODE_BENCH_NODES is not set";
+    }
+
+    benchJoin("inproc");
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+// same over local:// sockets, so the transport syscalls are in the figures
+TEST(module_ppn_node, bench_join_local)
+{
+    if(env("PPN_NODE_BENCH_NODES", "").empty())
+    {
+        GTEST_SKIP() << "PPN_NODE_BENCH_NODES is not set";
+    }
+
+    benchJoin("local");
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+// remotes churn of the given features over sim:// in wall clock time: dials get
+// latency, jitter, refusals and silent hangs; remotes per node and their received
+// bytes (Node::remotes, sampled) are taken until no joins or closes happen for
+// PPN_NODE_BENCH_STABLE samples in a row. Prints the degree and traffic timeline,
+// time to settle, connection churn and the traffic it took. Bytes of a remote
+// closed between samples are counted as of the sample before, so the figure is
+// a lower bound. Latency and loss are of dials only, established channels are
+// lossless inproc.
+// PPN_NODE_BENCH_NODES         nodes amount, the bench is skipped if not set
+// PPN_NODE_BENCH_FEATURES      comma separated feature list
+// PPN_NODE_BENCH_SAMPLE        sampling period, milliseconds
+// PPN_NODE_BENCH_STABLE        samples without churn to consider settled
+// PPN_NODE_BENCH_TIMEOUT       seconds to wait for settling
+// PPN_NODE_BENCH_SIM_LATENCY   dial latency, milliseconds
+// PPN_NODE_BENCH_SIM_JITTER    dial jitter, milliseconds
+// PPN_NODE_BENCH_SIM_FAIL      refused dials, 0..1
+// PPN_NODE_BENCH_SIM_HANG      silent hung dials, 0..1
+// PPN_NODE_BENCH_SIM_HANGFOR   hang duration, milliseconds
+TEST(module_ppn_node, bench_churn)
+{
+    if(env("PPN_NODE_BENCH_NODES", "").empty())
+    {
+        GTEST_SKIP() << "PPN_NODE_BENCH_NODES is not set";
+    }
+
+    const size_t nodesAmount = std::stoul(env("PPN_NODE_BENCH_NODES", "32"));
+    const std::string features = env("PPN_NODE_BENCH_FEATURES", "ppn::discovery::local::ProcessScope,ppn::discovery::Peer,ppn::topology::Lis,ppn::connectivity::Reest");
+    const std::chrono::milliseconds sample{std::stoul(env("PPN_NODE_BENCH_SAMPLE", "500"))};
+    const size_t stableSamples = std::stoul(env("PPN_NODE_BENCH_STABLE", "10"));
+    const std::chrono::seconds timeout{std::stoul(env("PPN_NODE_BENCH_TIMEOUT", "300"))};
+
+    std::vector<std::unique_ptr<BenchNode>> nodes;
+    size_t joins{}, closes{};
+
+    for(size_t i{}; i<nodesAmount; ++i)
+    {
+        std::unique_ptr<BenchNode> bn = startNode(i, features, "sim");
+        ASSERT_TRUE(bn);
+
+        BenchNode* raw = bn.get();
+        bn->_node->remoteJoined() += raw->_sbsOwner * [&, raw](const node::link::Id&, bool, uint64)
+        {
+            raw->_remotes++;
+            joins++;
+        };
+
+        bn->_node->remoteClosed() += raw->_sbsOwner * [&, raw](const node::link::Id&)
+        {
+            raw->_remotes--;
+            closes++;
+        };
+
+        nodes.emplace_back(std::move(bn));
+    }
+
+    cmt::Promise<void> done;
+    bool finished{};
+    bool settled{};
+    auto begin = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lastChange = begin;
+    size_t lastChurn{};
+    size_t unchanged{};
+
+    std::cout << "t, s; remotes; degree min/avg/max; joins; closes; bytes received" << std::endl;
+
+    poll::Timer sampler{sample, true, [&]
+    {
+        size_t total{}, minDegree{std::numeric_limits<size_t>::max()}, maxDegree{};
+        uint64 bytes{};
+        for(const std::unique_ptr<BenchNode>& bn : nodes)
+        {
+            total += bn->_remotes;
+            minDegree = std::min(minDegree, bn->_remotes);
+            maxDegree = std::max(maxDegree, bn->_remotes);
+            bytes += bn->bytes();
+
+            //next snapshot, lands before the next sample
+            BenchNode* raw = bn.get();
+            bn->_node->remotes(0).then() += raw->_sbsOwner * [raw](cmt::Future<List<node::RemoteInfo>> in)
+            {
+                if(!in.resolvedValue()) return;
+
+                std::map<node::link::Id, uint64> live;
+                for(const node::RemoteInfo& ri : in.detachValue())
+                {
+                    live[ri.id] = ri.bytesIn;
+                }
+
+                for(const auto&[id, b] : raw->_bytesLive)
+                {
+                    if(!live.contains(id)) raw->_bytesClosed += b;
+                }
+                raw->_bytesLive.swap(live);
+            };
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        std::cout
+            << std::chrono::duration<double>(now - begin).count() << "; "
+            << total << "; "
+            << minDegree << "/" << static_cast<double>(total) / static_cast<double>(nodes.size()) << "/" << maxDegree << "; "
+            << joins << "; "
+            << closes << "; "
+            << bytes << std::endl;
+
+        if(joins + closes != lastChurn)
+        {
+            lastChurn = joins + closes;
+            lastChange = now;
+            unchanged = 0;
+            return;
+        }
+
+        if(total && ++unchanged >= stableSamples && !finished)
+        {
+            finished = true;
+            settled = true;
+            done.resolveValue();
+        }
+    }};
+
+    poll::Timer deadline{timeout, false, [&]
+    {
+        if(!finished)
+        {
+            finished = true;
+            done.resolveValue();
+        }
+    }};
+
+    sampler.start();
+    deadline.start();
+    done.future().value();
+    sampler.stop();
+    deadline.stop();
+
+    std::cout << "nodes:             " << nodesAmount << std::endl;
+    std::cout << "features:          " << features << std::endl;
+    std::cout << "settled:           " << (settled ? "yes" : "no") << std::endl;
+    std::cout << "settled in, s:     " << std::chrono::duration<double>(lastChange - begin).count() << std::endl;
+    std::cout << "joins:             " << joins << std::endl;
+    std::cout << "closes:            " << closes << std::endl;
+
+    uint64 bytes{};
+    for(const std::unique_ptr<BenchNode>& bn : nodes)
+    {
+        bytes += bn->bytes();
+    }
+    std::cout << "bytes received:    " << bytes << std::endl;
+    std::cout << "bytes per node:    " << bytes / nodesAmount << std::endl;
+    std::cout << "bytes per join:    " << (joins ? bytes / joins : 0) << std::endl;
+
+    stopNodes(nodes);
+}
@@ -0,0 +1,68 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include <dci/test.hpp>
+#include "node/utils.hpp"
+
+using namespace dci::module::ppn;
+
+namespace
+{
+    String prefix(const char* a)
+    {
+        return node::utils::addressPrefix(transport::Address{a});
+    }
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, addressPrefix)
+{
+    EXPECT_EQ(String("4\x0a\x01\x02", 4), prefix("tcp4://10.1.2.3:1000"));
+    EXPECT_EQ(prefix("tcp4://10.1.2.3:1000"), prefix("tcp4://10.1.2.250"));
+    EXPECT_NE(prefix("tcp4://10.1.2.3:1000"), prefix("tcp4://10.1.3.3:1000"));
+
+    EXPECT_EQ(8u, prefix("tcp6://[2001:db8:0:1::1]:1000").size());
+    EXPECT_EQ(prefix("tcp6://[2001:db8:0:100::1]:1000"), prefix("tcp6://[2001:db8:0:1ff:ffff::2]:1000"));
+    EXPECT_NE(prefix("tcp6://[2001:db8:0:100::1]:1000"), prefix("tcp6://[2001:db8:0:200::1]:1000"));
+    EXPECT_EQ(prefix("tcp6://[fe80::1%eth0]:1000"), prefix("tcp6://[fe80::2]:1000"));
+
+    //families never share a key
+    EXPECT_NE(prefix("tcp4://0.0.0.1"), prefix("tcp6://[::1]"));
+
+    EXPECT_EQ(String{}, prefix("inproc://x"));
+    EXPECT_EQ(String{}, prefix("local:///tmp/x"));
+    EXPECT_EQ(String{}, prefix("tcp4://not.an.ip:1000"));
+    EXPECT_EQ(String{}, prefix("tcp6://[zz::1]:1000"));
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, addressCommonBits)
+{
+    auto bits = [](const char* a, const char* b)
+    {
+        return node::utils::addressCommonBits(transport::Address{a}, transport::Address{b});
+    };
+
+    EXPECT_EQ(32u, bits("tcp4://192.168.1.10:1000", "tcp4://192.168.1.10:2000"));
+    EXPECT_EQ(24u, bits("tcp4://192.168.1.10", "tcp4://192.168.1.200"));
+    EXPECT_EQ(23u, bits("tcp4://192.168.0.10", "tcp4://192.168.1.10"));
+    EXPECT_EQ(0u,  bits("tcp4://10.8.0.2", "tcp4://192.168.1.10"));
+    EXPECT_EQ(4u,  bits("tcp4://10.8.0.2", "tcp4://0.0.0.0"));
+
+    //a vpn lo shares less with a lan peer than the lan lo does
+    EXPECT_LT(bits("tcp4://10.8.0.2", "tcp4://192.168.1.10"), bits("tcp4://192.168.1.5", "tcp4://192.168.1.10"));
+
+    EXPECT_EQ(128u, bits("tcp6://[2001:db8::1]", "tcp6://[2001:db8::1]:5"));
+    EXPECT_EQ(64u,  bits("tcp6://[2001:db8:0:1::1]", "tcp6://[2001:db8:0:1:8000::1]"));
+
+    //different families and non-ip share nothing
+    EXPECT_EQ(0u, bits("tcp4://0.0.0.1", "tcp6://[::1]"));
+    EXPECT_EQ(0u, bits("inproc://x", "inproc://x"));
+
+    EXPECT_EQ(String("4\xc0\xa8\x01\x0a", 5), node::utils::addressHost(transport::Address{"tcp4://192.168.1.10:1000"}));
+    EXPECT_EQ(String{}, node::utils::addressHost(transport::Address{"local:///tmp/x"}));
+}
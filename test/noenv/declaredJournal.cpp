@@ -0,0 +1,93 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include <dci/test.hpp>
+#include "node/declaredJournal.hpp"
+
+using namespace dci::module::ppn;
+using Addresses = Set<transport::Address>;
+
+namespace
+{
+    transport::Address a1{"tcp4://10.0.0.1:1000"};
+    transport::Address a2{"tcp4://10.0.0.2:1000"};
+    transport::Address a3{"tcp4://10.0.0.3:1000"};
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, declaredSince_delta)
+{
+    node::DeclaredJournal j;
+    Addresses declared;
+
+    EXPECT_EQ(0u, j.version());
+
+    declared.insert(a1); j.changed(a1);
+    declared.insert(a2); j.changed(a2);
+    EXPECT_EQ(2u, j.version());
+
+    //up to date, nothing
+    api::feature::DeclaredDelta d = j.since(2, declared);
+    EXPECT_EQ(2u, d.version);
+    EXPECT_FALSE(d.full);
+    EXPECT_TRUE(d.added.empty());
+    EXPECT_TRUE(d.removed.empty());
+
+    //from the very beginning the journal still reaches, a delta
+    d = j.since(0, declared);
+    EXPECT_FALSE(d.full);
+    EXPECT_EQ((Addresses{a1, a2}), d.added);
+    EXPECT_TRUE(d.removed.empty());
+
+    declared.erase(a1); j.changed(a1);
+    declared.insert(a3); j.changed(a3);
+
+    d = j.since(2, declared);
+    EXPECT_EQ(4u, d.version);
+    EXPECT_FALSE(d.full);
+    EXPECT_EQ((Addresses{a3}), d.added);
+    EXPECT_EQ((Addresses{a1}), d.removed);
+
+    //added and removed again after the version is reported by its current state only
+    declared.insert(a1); j.changed(a1);
+    declared.erase(a1); j.changed(a1);
+    d = j.since(4, declared);
+    EXPECT_TRUE(d.added.empty());
+    EXPECT_EQ((Addresses{a1}), d.removed);
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, declaredSince_full)
+{
+    node::DeclaredJournal j{2};
+    Addresses declared;
+
+    //nothing journaled yet, unknown version
+    api::feature::DeclaredDelta d = j.since(5, declared);
+    EXPECT_TRUE(d.full);
+    EXPECT_TRUE(d.added.empty());
+
+    declared.insert(a1); j.changed(a1);
+    declared.insert(a2); j.changed(a2);
+    declared.insert(a3); j.changed(a3);
+
+    //version from the future
+    d = j.since(4, declared);
+    EXPECT_TRUE(d.full);
+    EXPECT_EQ(declared, d.added);
+    EXPECT_TRUE(d.removed.empty());
+
+    //only versions 2 and 3 are kept: 1 is still a delta, 0 is too old
+    d = j.since(1, declared);
+    EXPECT_FALSE(d.full);
+    EXPECT_EQ((Addresses{a2, a3}), d.added);
+
+    d = j.since(0, declared);
+    EXPECT_TRUE(d.full);
+    EXPECT_EQ(3u, d.version);
+    EXPECT_EQ(declared, d.added);
+}
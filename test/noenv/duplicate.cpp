@@ -0,0 +1,50 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include <dci/test.hpp>
+#include "node/utils.hpp"
+
+using namespace dci::module::ppn;
+using node::utils::duplicateKeepNew;
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, duplicate_simultaneousOpen)
+{
+    //both sides keep the connection initiated by the lower id:
+    //lower side keeps its own connect, higher side keeps its accept
+    EXPECT_TRUE (duplicateKeepNew(false, false, true,  true));
+    EXPECT_FALSE(duplicateKeepNew(true,  false, false, true));
+    EXPECT_FALSE(duplicateKeepNew(false, false, true,  false));
+    EXPECT_TRUE (duplicateKeepNew(true,  false, false, false));
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, duplicate_sameDirection)
+{
+    //the one joined earlier stays
+    for(bool ownIdLower : {false, true})
+    {
+        EXPECT_FALSE(duplicateKeepNew(true,  false, true,  ownIdLower));
+        EXPECT_FALSE(duplicateKeepNew(false, false, false, ownIdLower));
+    }
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, duplicate_existingClosing)
+{
+    //existing is going away, dropping the new one too would leave the pair without a connection
+    for(bool existingByConnect : {false, true})
+    {
+        for(bool newByConnect : {false, true})
+        {
+            for(bool ownIdLower : {false, true})
+            {
+                EXPECT_TRUE(duplicateKeepNew(existingByConnect, true, newByConnect, ownIdLower));
+            }
+        }
+    }
+}
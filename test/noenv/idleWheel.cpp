@@ -0,0 +1,99 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include <dci/test.hpp>
+#include "node/idleWheel.hpp"
+
+using namespace dci::module::ppn;
+using namespace std::chrono_literals;
+
+namespace
+{
+    //ticks until the serial comes out, 0 if not within the limit
+    size_t ticksUntil(node::IdleWheel& w, uint64 serial, size_t limit = 1000)
+    {
+        for(size_t i{1}; i<=limit; ++i)
+        {
+            for(const auto&[id, s] : w.advance())
+            {
+                if(s == serial) return i;
+            }
+        }
+
+        return 0;
+    }
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, idleWheel_configure)
+{
+    node::IdleWheel w;
+
+    w.configure(64s);
+    EXPECT_EQ(64s, w.timeout());
+    EXPECT_EQ(2s, w.tick());
+
+    //never below a second
+    w.configure(10s);
+    EXPECT_EQ(1s, w.tick());
+
+    //off, nothing is kept
+    w.configure(0s);
+    auto now = std::chrono::steady_clock::now();
+    w.schedule(api::link::Id{}, 1, now + 1s, now);
+    EXPECT_TRUE(w.advance().empty());
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, idleWheel_due)
+{
+    node::IdleWheel w;
+    w.configure(64s);
+    auto now = std::chrono::steady_clock::now();
+
+    //within one tick after due
+    w.schedule(api::link::Id{}, 1, now + 10s, now);
+    EXPECT_EQ(5u, ticksUntil(w, 1));
+
+    w.schedule(api::link::Id{}, 2, now + 11s, now);
+    EXPECT_EQ(6u, ticksUntil(w, 2));
+
+    //overdue or due right now, the next tick
+    w.schedule(api::link::Id{}, 3, now - 5s, now);
+    EXPECT_EQ(1u, ticksUntil(w, 3));
+    w.schedule(api::link::Id{}, 4, now, now);
+    EXPECT_EQ(1u, ticksUntil(w, 4));
+
+    //beyond the wheel, one timeout at most
+    w.schedule(api::link::Id{}, 5, now + 1h, now);
+    EXPECT_EQ(32u, ticksUntil(w, 5));
+
+    //comes out once
+    EXPECT_EQ(0u, ticksUntil(w, 5, 100));
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, idleWheel_wrap)
+{
+    node::IdleWheel w;
+    w.configure(10s);
+    auto now = std::chrono::steady_clock::now();
+
+    //scheduled after the cursor went round a few times
+    EXPECT_EQ(0u, ticksUntil(w, 1, 25));
+    w.schedule(api::link::Id{}, 1, now + 3s, now);
+    w.schedule(api::link::Id{}, 2, now + 10s, now);
+    EXPECT_EQ(3u, ticksUntil(w, 1));
+    EXPECT_EQ(7u, ticksUntil(w, 2));
+
+    //clear drops what is scheduled, the wheel stays usable
+    w.schedule(api::link::Id{}, 3, now + 2s, now);
+    w.clear();
+    EXPECT_EQ(0u, ticksUntil(w, 3, 20));
+    w.schedule(api::link::Id{}, 4, now + 2s, now);
+    EXPECT_EQ(2u, ticksUntil(w, 4));
+}
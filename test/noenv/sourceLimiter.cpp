@@ -0,0 +1,139 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include <dci/test.hpp>
+#include "node/sourceLimiter.hpp"
+
+using namespace dci::module::ppn;
+using Verdict = node::SourceLimiter::Verdict;
+
+namespace
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void configure(node::SourceLimiter& l, const char* rate, const char* burst, const char* sources = "65536")
+    {
+        config::ptree conf;
+        conf.put("rate", rate);
+        conf.put("burst", burst);
+        conf.put("sources", sources);
+
+        l.configure(conf);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    transport::Address ip4(int a, int b, int c)
+    {
+        return transport::Address{"tcp4://" + std::to_string(a) + "." + std::to_string(b) + "." + std::to_string(c) + ".1:1000"};
+    }
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, sourceLimiter_refill)
+{
+    node::SourceLimiter l;
+    configure(l, "10", "2");
+    auto t0 = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(Verdict::pass,    l.admit(ip4(10,0,0), t0));
+    EXPECT_EQ(Verdict::pass,    l.admit(ip4(10,0,0), t0));
+    EXPECT_EQ(Verdict::limited, l.admit(ip4(10,0,0), t0));
+
+    //same /24 is the same source
+    EXPECT_EQ(Verdict::limited, l.admit(transport::Address{"tcp4://10.0.0.200:2000"}, t0));
+
+    //one token per 100ms at 10/s
+    EXPECT_EQ(Verdict::pass,    l.admit(ip4(10,0,0), t0 + std::chrono::milliseconds{110}));
+    EXPECT_EQ(Verdict::limited, l.admit(ip4(10,0,0), t0 + std::chrono::milliseconds{120}));
+
+    //never above burst
+    auto t1 = t0 + std::chrono::seconds{10};
+    EXPECT_EQ(Verdict::pass,    l.admit(ip4(10,0,0), t1));
+    EXPECT_EQ(Verdict::pass,    l.admit(ip4(10,0,0), t1));
+    EXPECT_EQ(Verdict::limited, l.admit(ip4(10,0,0), t1));
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, sourceLimiter_cap)
+{
+    node::SourceLimiter l;
+    configure(l, "1", "1", "4");
+    auto t0 = std::chrono::steady_clock::now();
+
+    for(int i{}; i<100; ++i)
+    {
+        EXPECT_EQ(Verdict::pass, l.admit(ip4(10,0,i), t0));
+        EXPECT_LE(l.tracked(), 4u);
+    }
+    EXPECT_EQ(4u, l.tracked());
+
+    //ip6 sources of the same /56 share one bucket
+    configure(l, "1", "1", "4");
+    EXPECT_EQ(Verdict::pass,    l.admit(transport::Address{"tcp6://[2001:db8:0:100::1]:1000"}, t0));
+    EXPECT_EQ(Verdict::limited, l.admit(transport::Address{"tcp6://[2001:db8:0:1ff::2]:1000"}, t0));
+    EXPECT_EQ(Verdict::pass,    l.admit(transport::Address{"tcp6://[2001:db8:0:200::1]:1000"}, t0));
+    EXPECT_EQ(2u, l.tracked());
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, sourceLimiter_eviction)
+{
+    node::SourceLimiter l;
+    configure(l, "1", "1", "2");
+    auto t0 = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(Verdict::pass,    l.admit(ip4(10,0,1), t0));
+    EXPECT_EQ(Verdict::pass,    l.admit(ip4(10,0,2), t0));
+
+    //seen again, 10.0.2 is the least recent now
+    EXPECT_EQ(Verdict::limited, l.admit(ip4(10,0,1), t0));
+
+    //pushes 10.0.2 out
+    EXPECT_EQ(Verdict::pass,    l.admit(ip4(10,0,3), t0));
+    EXPECT_EQ(2u, l.tracked());
+
+    EXPECT_EQ(Verdict::limited, l.admit(ip4(10,0,1), t0));
+    EXPECT_EQ(Verdict::pass,    l.admit(ip4(10,0,2), t0));
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, sourceLimiter_purge)
+{
+    node::SourceLimiter l;
+    configure(l, "10", "1");
+    auto t0 = std::chrono::steady_clock::now();
+
+    for(int i{}; i<4; ++i)
+    {
+        EXPECT_EQ(Verdict::pass, l.admit(ip4(10,0,i), t0));
+    }
+    EXPECT_EQ(4u, l.tracked());
+
+    //refilled buckets go away a few per admit, not all at once
+    EXPECT_EQ(Verdict::pass, l.admit(ip4(10,1,0), t0 + std::chrono::seconds{1}));
+    EXPECT_EQ(3u, l.tracked());
+    EXPECT_EQ(Verdict::pass, l.admit(ip4(10,1,0), t0 + std::chrono::seconds{1}));
+    EXPECT_EQ(1u, l.tracked());
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, sourceLimiter_block)
+{
+    config::ptree conf;
+    conf.add("block", "tcp4://203.0.113.1");
+    conf.add("block", "tcp6://[2001:db8::1]");
+
+    node::SourceLimiter l;
+    l.configure(conf);
+    EXPECT_TRUE(l.active());
+
+    auto t0 = std::chrono::steady_clock::now();
+    EXPECT_EQ(Verdict::blocked, l.admit(transport::Address{"tcp4://203.0.113.77:5000"}, t0));
+    EXPECT_EQ(Verdict::blocked, l.admit(transport::Address{"tcp6://[2001:db8:0:ff::5]:5000"}, t0));
+    EXPECT_EQ(Verdict::pass,    l.admit(transport::Address{"tcp4://203.0.114.77:5000"}, t0));
+    EXPECT_EQ(Verdict::pass,    l.admit(transport::Address{"inproc://x"}, t0));
+    EXPECT_EQ(0u, l.tracked());
+}
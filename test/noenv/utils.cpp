@@ -0,0 +1,105 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include <dci/test.hpp>
+#include "node/utils.hpp"
+
+using namespace dci::module::ppn;
+using Ports = std::vector<String>;
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, parsePorts)
+{
+    //nothing given, the transport chooses
+    EXPECT_EQ(Ports{""}, node::utils::parsePorts(""));
+    EXPECT_EQ(Ports{""}, node::utils::parsePorts(" , "));
+
+    EXPECT_EQ((Ports{"0"}), node::utils::parsePorts("0"));
+    EXPECT_EQ((Ports{"65535"}), node::utils::parsePorts("65535"));
+    EXPECT_EQ((Ports{"80"}), node::utils::parsePorts("00080"));
+    EXPECT_EQ((Ports{"1000", "1001", "1002", "2000"}), node::utils::parsePorts("1000-1002, 2000"));
+    EXPECT_EQ((Ports{"7", "8"}), node::utils::parsePorts("7 8"));
+    EXPECT_EQ((Ports{"5"}), node::utils::parsePorts("5-5"));
+
+    EXPECT_EQ(4096u, node::utils::parsePorts("1-4096").size());
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, parsePorts_bad)
+{
+    EXPECT_ANY_THROW(node::utils::parsePorts("65536"));
+    EXPECT_ANY_THROW(node::utils::parsePorts("123456"));
+    EXPECT_ANY_THROW(node::utils::parsePorts("-1"));
+    EXPECT_ANY_THROW(node::utils::parsePorts("http"));
+    EXPECT_ANY_THROW(node::utils::parsePorts("10-5"));
+    EXPECT_ANY_THROW(node::utils::parsePorts("1-65536"));
+    EXPECT_ANY_THROW(node::utils::parsePorts("1 - 2"));
+
+    //bounded, a single range and a sum of ranges both
+    EXPECT_ANY_THROW(node::utils::parsePorts("1-4097"));
+    EXPECT_ANY_THROW(node::utils::parsePorts("1-4096,5000"));
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, mergeOptions)
+{
+    config::ptree base;
+    base.put("nodelay", "true");
+    base.put("sndbuf", "65536");
+
+    config::ptree over;
+    over.put("sndbuf", "131072");
+    over.put("keepalive", "on");
+
+    config::ptree res = node::utils::mergeOptions(base, over);
+    EXPECT_EQ(3u, res.size());
+    EXPECT_EQ("true", res.get<String>("nodelay"));
+    EXPECT_EQ("131072", res.get<String>("sndbuf"));
+    EXPECT_EQ("on", res.get<String>("keepalive"));
+
+    //no duplicates for a key given on both levels
+    EXPECT_EQ(1u, res.count("sndbuf"));
+
+    //base is left as is
+    EXPECT_EQ("65536", base.get<String>("sndbuf"));
+
+    EXPECT_EQ(2u, node::utils::mergeOptions(base, config::ptree{}).size());
+    EXPECT_EQ(2u, node::utils::mergeOptions(config::ptree{}, over).size());
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+TEST(module_ppn_node, checkSocketOptions)
+{
+    auto check = [](const char* key, const char* value)
+    {
+        config::ptree options;
+        options.put(key, value);
+        node::utils::checkSocketOptions(options);
+    };
+
+    EXPECT_NO_THROW(node::utils::checkSocketOptions(config::ptree{}));
+    EXPECT_NO_THROW(check("nodelay", "true"));
+    EXPECT_NO_THROW(check("keepalive", "off"));
+    EXPECT_NO_THROW(check("fastopen", "1"));
+    EXPECT_NO_THROW(check("backlog", "128"));
+    EXPECT_NO_THROW(check("sndbuf", "2147483647"));
+    EXPECT_NO_THROW(check("rcvbuf", "1"));
+
+    EXPECT_ANY_THROW(check("nodelay", "maybe"));
+    EXPECT_ANY_THROW(check("backlog", "0"));
+    EXPECT_ANY_THROW(check("backlog", "-1"));
+    EXPECT_ANY_THROW(check("backlog", "012"));
+    EXPECT_ANY_THROW(check("sndbuf", "2147483648"));
+    EXPECT_ANY_THROW(check("rcvbuf", "64k"));
+    EXPECT_ANY_THROW(check("linger", "1"));
+
+    EXPECT_TRUE(node::utils::tcpSocketOption("nodelay"));
+    EXPECT_TRUE(node::utils::tcpSocketOption("keepalive"));
+    EXPECT_TRUE(node::utils::tcpSocketOption("fastopen"));
+    EXPECT_FALSE(node::utils::tcpSocketOption("sndbuf"));
+    EXPECT_FALSE(node::utils::tcpSocketOption("backlog"));
+}